@@ -0,0 +1,204 @@
+// A program to measure how the counting scales with the diagrams (runtime, peak memory and visited states on random diagrams)
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include<fstream>
+#include<iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <boost/multiprecision/cpp_int.hpp>
+#include "rootCounter.h"
+#include "driver_options.cpp"
+#include "diagram_generator.cpp"
+#include "peak_memory.cpp"
+
+// Optimizations for speedup
+#pragma GCC optimize("Ofast")
+
+// Global variables
+int thread_number = 0; // set in main: --threads=<n>, otherwise detected from the hardware and the cgroup CPU quota
+driver_options options;
+
+
+// One point of a scaling curve
+struct benchmark_point{
+    int vertices;
+    int genus;
+    int multiplicity;
+    int genus_one_vertices;
+    int root;
+};
+
+
+// Name of an engine (as in --engine)
+std::string engine_name(const RootCountEngine & engine)
+{
+    switch (engine){
+        case RootCountEngine::int128: return "int128";
+        case RootCountEngine::modular: return "modular";
+        case RootCountEngine::meet_in_the_middle: return "meet-in-the-middle";
+        case RootCountEngine::frontier: return "frontier";
+    }
+    return "unknown";
+}
+
+
+// determine the distributions of the fluxes of one random diagram and append a line to the scaling curves
+// (returns the seconds of the count, -1 if there is no diagram for this point)
+double run_point(const std::string & curve, const benchmark_point & point, const int & sample, RootCountThreadPool & pool, std::ofstream & ofile)
+{
+    
+    // (0) hard coded settings (as in the counters)
+    int h0Max = 4;
+    int number_of_fluxes = 8;
+    
+    // (1) draw the diagram (the same for every engine and version, as the seed only depends on the sample)
+    random_diagram diagram;
+    if (!generate_diagram(point.vertices, point.genus, point.multiplicity, point.genus_one_vertices, point.root, number_of_fluxes, sample + 1, diagram)){
+        return -1;
+    }
+    std::vector<std::vector<int>> reduced_degrees(diagram.fluxes.size(), diagram.degrees);
+    for (int i = 0; i < diagram.fluxes.size(); i++){
+        for (int j = 0; j < diagram.degrees.size(); j++){
+            reduced_degrees[i][j] -= diagram.fluxes[i][j];
+        }
+    }
+    
+    // (2) count all fluxes in one batch
+    reset_peak_memory();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::shared_ptr<RootCountGraph> graph = std::make_shared<RootCountGraph>(diagram.edges, diagram.degrees.size());
+    graph->replicate(pool);
+    RootCountProgress progress("", options.status_interval, thread_number);
+    RootCountBatch batch(graph, diagram.genus, reduced_degrees, diagram.genera, diagram.root);
+    batch.set_progress(&progress);
+    batch.set_frontier_memory(options.frontier_memory);
+    std::vector<std::vector<boost::multiprecision::cpp_int>> dists = batch.distributions(h0Max, &pool, options.engine, options.total == "derive");
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    // (3) sum of all counts (to compare engines and versions) and the largest frontier
+    boost::multiprecision::cpp_int count = 0;
+    for (int i = 0; i < dists.size(); i++){
+        count = std::accumulate(dists[i].begin(), dists[i].end(), count);
+    }
+    std::vector<long long> frontiers = progress.frontier_sizes();
+    long long largest_frontier = (frontiers.size() > 0) ? *std::max_element(frontiers.begin(), frontiers.end()) : 0;
+    
+    // (4) append the line
+    ofile << curve << "," << point.vertices << "," << diagram.edges.size() << "," << point.genus << "," << point.multiplicity << ",";
+    ofile << point.genus_one_vertices << "," << point.root << "," << sample << "," << diagram.fluxes.size() << ",";
+    ofile << engine_name(options.engine) << "," << counting_isa() << "," << thread_number << "," << seconds << ",";
+    ofile << peak_memory() << "," << progress.states_visited() << "," << largest_frontier << "," << count << "\n";
+    ofile.flush();
+    return seconds;
+    
+}
+
+
+// #################
+// The main routine
+// The main routine
+// #################
+
+int main(int argc, char* argv[]) {
+    
+    // check if we have the correct number of arguments
+    if (argc < 2) {
+        std::cout << "Error - number of arguments must be at least 1 and not " << argc - 1 << "\n";
+        std::cout << argv[ 0 ] << "\n";
+        return 0;
+    }
+    
+    // parse optional arguments
+    if (!parse_driver_options(argc, argv, 2, options)){
+        return -1;
+    }
+    thread_number = (options.threads > 0) ? options.threads : detect_thread_number();
+    
+    // parse input
+    std::string myString = argv[1];
+    std::stringstream iss( myString );
+    std::vector<int> input;
+    int number;
+    while ( iss >> number ){
+        input.push_back( number );
+    }
+    
+    // check input: largest number of vertices, genus, edge multiplicity and root, samples per point and seconds per point
+    // (a curve stops after the first point whose samples take longer on average)
+    if (input.size() != 6 || input[0] < 2 || input[1] < 2 || input[2] < 1 || input[3] < 2 || input[4] < 1 || input[5] < 1){
+        std::cout << "Invalid input.\n";
+        return -1;
+    }
+    int max_vertices = input[0];
+    int max_genus = input[1];
+    int max_multiplicity = input[2];
+    int max_root = input[3];
+    int samples = input[4];
+    double seconds_limit = input[5];
+    
+    // (1) base point of all curves (about the size of diagram 88), every curve varies one parameter
+    // (the vertex curve raises the genus with the vertices, so that the genus zero vertices keep three edges)
+    benchmark_point base = {4, 6, 2, 1, 8};
+    std::vector<std::string> curves = {"vertices", "genus", "multiplicity", "root"};
+    std::vector<int> first_values = {2, 2, 1, 2};
+    std::vector<int> last_values = {max_vertices, max_genus, max_multiplicity, max_root};
+    
+    // (2) open the scaling curves (one line per point and sample)
+    mkdir("results_benchmark", 0755);
+    std::string file_name = "results_benchmark/scaling_curves.csv";
+    bool new_file = !std::ifstream(file_name.c_str()).good();
+    std::ofstream ofile(file_name.c_str(), std::ios_base::app);
+    if (new_file){
+        ofile << "curve,vertices,edges,genus,multiplicity,genus_one_vertices,root,sample,fluxes,engine,isa,threads,seconds,";
+        ofile << "peak_memory_kib,states,largest_frontier,count\n";
+    }
+    
+    // (3) run the curves
+    RootCountThreadPool pool(thread_number - 1, options.pin_threads);
+    for (int c = 0; c < curves.size(); c++){
+        for (int value = first_values[c]; value <= last_values[c]; value++){
+            benchmark_point point = base;
+            if (curves[c] == "vertices"){
+                point.vertices = value;
+                point.genus = std::max(base.genus, value + 2);
+            }
+            if (curves[c] == "genus"){
+                point.genus = value;
+            }
+            if (curves[c] == "multiplicity"){
+                point.multiplicity = value;
+            }
+            if (curves[c] == "root"){
+                point.root = value;
+            }
+            
+            // (3.1) all samples of this point (points without diagrams are skipped)
+            double seconds = 0;
+            int runs = 0;
+            for (int sample = 0; sample < samples; sample++){
+                double run_seconds = run_point(curves[c], point, sample, pool, ofile);
+                if (run_seconds >= 0){
+                    seconds += run_seconds;
+                    runs++;
+                }
+            }
+            std::cout << "Curve " << curves[c] << ": " << value << " (" << ((runs > 0) ? seconds / runs : 0) << "[s])\n";
+            
+            // (3.2) stop the curve once the points get too expensive
+            if (runs > 0 && seconds / runs > seconds_limit){
+                break;
+            }
+        }
+    }
+    
+    // return success
+    return 0;
+    
+}
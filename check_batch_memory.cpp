@@ -0,0 +1,93 @@
+// A program to check that walking the outfluxes of a batch (the trie behind RootCountBatch) needs memory independent of
+// the number of outfluxes: random diagrams with growing numbers of vertices (and genera) are walked, whose outfluxes grow
+// by orders of magnitude, and the peak memory of every walk is compared with that of the smallest one
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <vector>
+#include <sys/resource.h>
+#include "rootCounter.h"
+#include "diagram_generator.cpp"
+#include "peak_memory.cpp"
+
+
+// #################
+// The main routine
+// #################
+
+int main(int argc, char* argv[]) {
+    
+    // check if we have the correct number of arguments
+    if (argc != 2) {
+        std::cout << "Error - number of arguments must be 1 and not " << argc - 1 << "\n";
+        std::cout << argv[ 0 ] << "\n";
+        return 0;
+    }
+    
+    // parse input
+    std::string myString = argv[1];
+    std::stringstream iss( myString );
+    std::vector<int> input;
+    int number;
+    while ( iss >> number ){
+        input.push_back( number );
+    }
+    
+    // check input: largest number of vertices and the allowed growth of the peak memory in KiB
+    if (input.size() != 2 || input[0] < 4 || input[1] < 0){
+        std::cout << "Invalid input.\n";
+        return -1;
+    }
+    int max_vertices = input[0];
+    int allowed_growth = input[1];
+    
+    // walk the outfluxes (h0 <= 4, as in the counters) of diagrams with 4, 5, ..., max_vertices vertices, genus about
+    // 3/2 of the vertices and root 20 (from 143 outfluxes for 4 vertices to 342597 for 10 vertices)
+    long smallest_peak = -1;
+    long largest_growth = 0;
+    for (int vertices = 4; vertices <= max_vertices; vertices++){
+        
+        // (1) draw the diagram
+        random_diagram diagram;
+        if (!generate_diagram(vertices, (3 * vertices) / 2 - 1, 2, 1, 20, 8, 1, diagram)){
+            continue;
+        }
+        std::vector<std::vector<int>> reduced_degrees(diagram.fluxes.size(), diagram.degrees);
+        for (int i = 0; i < diagram.fluxes.size(); i++){
+            for (int j = 0; j < diagram.degrees.size(); j++){
+                reduced_degrees[i][j] -= diagram.fluxes[i][j];
+            }
+        }
+        std::shared_ptr<RootCountGraph> graph = std::make_shared<RootCountGraph>(diagram.edges, diagram.degrees.size());
+        RootCountBatch batch(graph, diagram.genus, reduced_degrees, diagram.genera, diagram.root);
+        
+        // (2) walk the trie once
+        reset_peak_memory();
+        long before = peak_memory();
+        std::vector<long long> counts = batch.outflux_counts(4);
+        long peak = peak_memory();
+        long long outfluxes = std::accumulate(counts.begin(), counts.end(), 0LL);
+        
+        // (3) compare with the smallest walk
+        if (smallest_peak < 0){
+            smallest_peak = peak;
+        }
+        largest_growth = std::max(largest_growth, peak - smallest_peak);
+        std::cout << "Vertices: " << vertices << " (" << outfluxes << " outfluxes, peak memory " << peak << " KiB, " << peak - before << " KiB during the walk)\n";
+        
+    }
+    
+    // return 1 if the peak memory grew by more than allowed
+    std::cout << "Largest growth of the peak memory: " << largest_growth << " KiB\n";
+    if (largest_growth > allowed_growth){
+        std::cout << "The peak memory grows with the number of outfluxes.\n";
+        return 1;
+    }
+    return 0;
+    
+}
@@ -0,0 +1,194 @@
+// A program to check the graph information (edge_numbers and graph_stratification) against the original construction,
+// which rescans the remaining edges for every vertex, on large random multigraphs (connected, with multiple edges and
+// loops, whose ends the original construction counts in its own way)
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <vector>
+#include "rootCounter.h"
+
+
+// method to check if a vector contains an element
+template <typename T>
+bool contains(const std::vector<T> & vec, const T & elem)
+{
+    bool result = false;
+    if(std::find(vec.begin(), vec.end(), elem) != vec.end())
+    {
+        result = true;
+    }
+    return result;
+}
+
+
+// method to compute new graph_information (the original construction, quadratic in the number of edges)
+void original_graph_information(
+                                  const std::vector<std::vector<int>> & edges,
+                                  std::vector<int> & edge_numbers,
+                                  std::vector<std::vector<std::vector<int>>> & graph_stratification )
+{
+    
+    // compute the edge_numbers
+    for (int i = 0; i < edges.size(); i++){
+        edge_numbers[edges[i][0]]++;
+        edge_numbers[edges[i][1]]++;
+    }
+    
+    // compute the graph_stratification
+    bool test = true;
+    int index = 0;
+    std::vector<std::vector<int>> scan_edges(edges.begin(), edges.end());
+    while (test) {
+        
+        // determine the vertices connected to the index-th vertex
+        std::vector<int> connected_vertices;
+        for (int i = 0; i < scan_edges.size(); i++){
+            if (scan_edges[i][0] == index && contains(connected_vertices, scan_edges[i][1]) == false){
+                connected_vertices.push_back(scan_edges[i][1]);
+            }
+            if (scan_edges[i][1] == index && contains(connected_vertices, scan_edges[i][0]) == false){
+                connected_vertices.push_back(scan_edges[i][0]);
+            }
+        }
+        
+        // determine the number of connecting edges
+        std::vector<int> number_of_connecting_edges(connected_vertices.size(),0);
+        for (int i = 0; i < connected_vertices.size(); i++){
+            for (int j = 0; j < scan_edges.size(); j++){
+                if (scan_edges[j][0] == index && scan_edges[j][1] == connected_vertices[i]){
+                    number_of_connecting_edges[i]++;
+                }
+                if (scan_edges[j][1] == index && scan_edges[j][0] == connected_vertices[i]){
+                    number_of_connecting_edges[i]++;
+                }
+            }
+        }
+        
+        // determine the number of remaining edges for all connected
+        std::vector<int> remaining_edges(connected_vertices.size(),0);
+        for (int i = 0; i < connected_vertices.size(); i++){
+            for (int j = 0; j < scan_edges.size(); j++){
+                if (scan_edges[j][0] != index && scan_edges[j][1] == connected_vertices[i]){
+                    remaining_edges[i]++;
+                }
+                if (scan_edges[j][1] != index && scan_edges[j][0] == connected_vertices[i]){
+                    remaining_edges[i]++;
+                }
+            }
+        }
+        
+        // add data to graph_stratification
+        graph_stratification.push_back({connected_vertices, number_of_connecting_edges, remaining_edges});
+        
+        // compute new list of edges
+        std::vector<std::vector<int>> new_edges;
+        for (int i = 0; i < scan_edges.size(); i++){
+            if (scan_edges[i][0] != index && scan_edges[i][1] != index){
+                new_edges.push_back(scan_edges[i]);
+            }
+        }
+        
+        // check if we are done: are there no remaining edges?
+        if (new_edges.size() == 0){
+            // yes -> end while loop
+            test = false;
+        }
+        else{
+            // not yet done -> prepare for next iteration
+            index++;
+            scan_edges = new_edges;
+        }
+        
+    }
+    
+}
+
+
+// #################
+// The main routine
+// #################
+
+int main(int argc, char* argv[]) {
+    
+    // check if we have the correct number of arguments
+    if (argc != 2) {
+        std::cout << "Error - number of arguments must be 1 and not " << argc - 1 << "\n";
+        std::cout << argv[ 0 ] << "\n";
+        return 0;
+    }
+    
+    // parse input
+    std::string myString = argv[1];
+    std::stringstream iss( myString );
+    std::vector<int> input;
+    int number;
+    while ( iss >> number ){
+        input.push_back( number );
+    }
+    
+    // check input: largest number of vertices and samples per number of vertices
+    if (input.size() != 2 || input[0] < 4 || input[1] < 1){
+        std::cout << "Invalid input.\n";
+        return -1;
+    }
+    int max_vertices = input[0];
+    int samples = input[1];
+    
+    // compare both constructions on graphs with 4, 8, 16, ..., max_vertices vertices (a random spanning tree, twice as many
+    // further edges between random vertices and a few loops, all in random order)
+    int mismatches = 0;
+    for (int vertices = std::min(4, max_vertices); ; vertices = std::min(2 * vertices, max_vertices)){
+        double original_seconds = 0;
+        double seconds = 0;
+        for (int sample = 0; sample < samples; sample++){
+            
+            // (1) draw the graph
+            std::mt19937_64 generator(sample + 1);
+            std::vector<std::vector<int>> edges;
+            for (int v = 1; v < vertices; v++){
+                edges.push_back({std::uniform_int_distribution<int>(0, v - 1)(generator), v});
+            }
+            for (int i = 0; i < 2 * vertices; i++){
+                int u = std::uniform_int_distribution<int>(0, vertices - 1)(generator);
+                int v = std::uniform_int_distribution<int>(0, vertices - 2)(generator);
+                edges.push_back({u, (v < u) ? v : v + 1});
+            }
+            for (int i = 0; i < vertices / 8 + 1; i++){
+                int v = std::uniform_int_distribution<int>(0, vertices - 1)(generator);
+                edges.push_back({v, v});
+            }
+            std::shuffle(edges.begin(), edges.end(), generator);
+            
+            // (2) compute the graph information with both constructions
+            std::vector<int> original_edge_numbers(vertices, 0), edge_numbers(vertices, 0);
+            std::vector<std::vector<std::vector<int>>> original_stratification, stratification;
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            original_graph_information(edges, original_edge_numbers, original_stratification);
+            std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+            additional_graph_information(edges, edge_numbers, stratification);
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+            original_seconds += std::chrono::duration<double>(middle - start).count();
+            seconds += std::chrono::duration<double>(end - middle).count();
+            
+            // (3) compare
+            if (original_edge_numbers != edge_numbers || original_stratification != stratification){
+                std::cout << "Mismatch for " << vertices << " vertices, sample " << sample << "\n";
+                mismatches++;
+            }
+            
+        }
+        std::cout << "Vertices: " << vertices << " (" << samples << " graphs, original " << original_seconds << "[s], now " << seconds << "[s])\n";
+        if (vertices == max_vertices){
+            break;
+        }
+    }
+    
+    // return the number of mismatches
+    std::cout << "Mismatches: " << mismatches << "\n";
+    return mismatches;
+    
+}
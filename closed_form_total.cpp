@@ -0,0 +1,207 @@
+// Number of roots summed over all h0 (see RootCountProblem::total in rootCounter.h).
+//
+// Summed over all h0, the outflux f of a vertex runs through every value f = d (mod root) with E <= f <= E * (root-1)
+// exactly once (d = reduced degree, E = number of edges at the vertex): for genus 0, h = 0 gives f > d and h > 0 gives
+// f = d + root - root * h; for genus 1, h = 0 gives f >= d and h > 0 gives f = d - root * h. So the total is the number
+// of nowhere-zero Z_root flows on the graph with boundary d (mod root), times root^2 per genus one vertex.
+//
+// The flows follow from deletion-contraction: their number is a signed sum over partitions of the vertices (the leaves)
+// of [the boundary sums to 0 (mod root) on every block]. Only if a genus one vertex can have h = 0, its factor
+// (root^2 - 1 for f >= d) depends on the outflux f itself. Such vertices are left out of the deletion-contraction, and
+// the weights on their edges are summed up as polynomials in their outfluxes, restricted to the residues of the blocks.
+// The leaves do not depend on the degrees otherwise, so every RootCountGraph expands them once per set of special vertices.
+
+
+// Largest number of terms of these polynomials (otherwise no total is computed)
+const double total_term_limit = 1 << 22;
+
+
+// Largest number of edges for deletion-contraction (2^edges leaves)
+const int total_edge_limit = 24;
+
+
+// Polynomial in the outfluxes of the special vertices, exponents -> coefficient (arbitrary precision: the coefficients
+// grow like root^edges at the special vertices and leave 128 bits e.g. at a genus one vertex with 20 edges and root 60)
+typedef std::unordered_map<std::vector<int>, boost::multiprecision::cpp_int, flux_hash> total_polynomial;
+
+
+// Task: Expand the nowhere-zero Z_root flows on a graph by deletion-contraction (edges between representatives).
+// Output: leaves = coefficient of every partition of the vertices (vertex -> representative of its block)
+void deletion_contraction(
+                          const std::vector<std::vector<int>> & edges,
+                          const std::vector<int> & representatives,
+                          const boost::multiprecision::cpp_int & coefficient,
+                          const int & root,
+                          std::map<std::vector<int>, boost::multiprecision::cpp_int> & leaves )
+{
+    
+    // no edges: the boundary has to sum to 0 on every block
+    if (edges.size() == 0){
+        leaves[representatives] += coefficient;
+        return;
+    }
+    
+    // a loop takes any non-zero value
+    std::vector<std::vector<int>> rest(edges.begin(), edges.end() - 1);
+    int u = edges.back()[0];
+    int v = edges.back()[1];
+    if (u == v){
+        deletion_contraction(rest, representatives, coefficient * (root - 1), root, leaves);
+        return;
+    }
+    
+    // all values on the edge (contraction) minus the zero value (deletion)
+    deletion_contraction(rest, representatives, -coefficient, root, leaves);
+    std::vector<int> merged = representatives;
+    for (int & w : merged){
+        w = (w == v) ? u : w;
+    }
+    for (std::vector<int> & edge : rest){
+        for (int & w : edge){
+            w = (w == v) ? u : w;
+        }
+    }
+    deletion_contraction(rest, merged, coefficient, root, leaves);
+    
+}
+
+
+// Task: Multiply a polynomial in the outfluxes of the special vertices by the sum over the weights of an edge (w at the
+// end in first_slot, root - w at the end in second_slot). The last exponent is a residue mod root.
+total_polynomial add_edge_weights(const total_polynomial & polynomial, const int & first_slot, const int & second_slot, const int & root)
+{
+    total_polynomial product;
+    for (total_polynomial::const_iterator it = polynomial.begin(); it != polynomial.end(); it++){
+        for (int w = 1; w < root; w++){
+            std::vector<int> exponents = it->first;
+            exponents[first_slot] += w;
+            exponents[second_slot] += root - w;
+            exponents.back() %= root;
+            product[exponents] += it->second;
+        }
+    }
+    return product;
+}
+
+
+// Task: Largest h0 with possibly non-zero count (every vertex at its largest h, i.e. smallest outflux f >= E).
+int closed_form_h0_top(const std::vector<int> & degrees, const std::vector<int> & genera, const std::vector<int> & edge_numbers, const int & root)
+{
+    int top = 0;
+    for (int j = 0; j < degrees.size(); j++){
+        int slack = degrees[j] + ((genera[j] == 0) ? root : 0) - edge_numbers[j];
+        top += (slack >= root) ? slack / root : 0;
+    }
+    return top;
+}
+
+
+// Task: Number of roots summed over all h0.
+// Output: -1 if the graph is too large for deletion-contraction or the polynomials get too large
+boost::multiprecision::cpp_int closed_form_total(
+                                const std::vector<int> & degrees,
+                                const std::vector<int> & genera,
+                                const RootCountGraph & graph,
+                                const int & root )
+{
+    
+    const std::vector<std::vector<int>> & edges = graph.edges;
+    const std::vector<int> & edge_numbers = graph.edge_numbers;
+    
+    // (1) genus one vertices which can have h = 0 (f = d (mod root) with max(d, E) <= f <= E * (root-1)) are special,
+    // the other genus one vertices contribute root^2
+    int number_of_vertices = degrees.size();
+    std::vector<int> special_slot(number_of_vertices, -1);
+    int number_of_special = 0;
+    double terms = root;
+    boost::multiprecision::cpp_int factor = 1;
+    for (int j = 0; j < number_of_vertices; j++){
+        if (genera[j] == 1){
+            int f = std::max(degrees[j], edge_numbers[j]);
+            f += ((degrees[j] - f) % root + root) % root;
+            if (f <= edge_numbers[j] * (root-1)){
+                special_slot[j] = number_of_special++;
+                terms *= edge_numbers[j] * (root-1) + 1;
+            }
+            else{
+                factor *= root * root;
+            }
+        }
+    }
+    
+    // (2) deletion-contraction of the edges between the other vertices (shared by all degrees with these special vertices)
+    if (terms > total_term_limit){
+        return -1;
+    }
+    std::vector<int> special(number_of_vertices, 0);
+    for (int j = 0; j < number_of_vertices; j++){
+        special[j] = (special_slot[j] >= 0) ? 1 : 0;
+    }
+    std::shared_ptr<const std::map<std::vector<int>, boost::multiprecision::cpp_int>> shared_leaves = graph.total_leaves(special, root);
+    if (!shared_leaves){
+        return -1;
+    }
+    const std::map<std::vector<int>, boost::multiprecision::cpp_int> & leaves = *shared_leaves;
+    
+    // (3) evaluate every leaf
+    boost::multiprecision::cpp_int total = 0;
+    for (std::map<std::vector<int>, boost::multiprecision::cpp_int>::const_iterator leaf = leaves.begin(); leaf != leaves.end(); leaf++){
+        
+        // (3.1) every block: weights on the edges to special vertices, such that what they leave of the degrees of the
+        // block sums to 0 (the last exponent counts up from -(sum of the degrees))
+        total_polynomial polynomial;
+        polynomial[std::vector<int>(number_of_special + 1, 0)] = 1;
+        for (int b = 0; b < number_of_vertices && polynomial.size() > 0; b++){
+            if (special_slot[b] >= 0 || leaf->first[b] != b){
+                continue;
+            }
+            int degree = 0;
+            for (int j = 0; j < number_of_vertices; j++){
+                degree += (leaf->first[j] == b) ? degrees[j] : 0;
+            }
+            total_polynomial block;
+            for (total_polynomial::const_iterator it = polynomial.begin(); it != polynomial.end(); it++){
+                std::vector<int> exponents = it->first;
+                exponents.back() = ((-degree) % root + root) % root;
+                block[exponents] = it->second;
+            }
+            for (const std::vector<int> & edge : edges){
+                for (int end = 0; end < 2; end++){
+                    if (special_slot[edge[end]] >= 0 && special_slot[edge[1-end]] < 0 && leaf->first[edge[1-end]] == b){
+                        block = add_edge_weights(block, special_slot[edge[end]], number_of_special, root);
+                    }
+                }
+            }
+            polynomial.clear();
+            for (total_polynomial::const_iterator it = block.begin(); it != block.end(); it++){
+                if (it->first.back() == 0){
+                    polynomial[it->first] = it->second;
+                }
+            }
+        }
+        
+        // (3.2) edges between special vertices
+        for (const std::vector<int> & edge : edges){
+            if (special_slot[edge[0]] >= 0 && special_slot[edge[1]] >= 0 && polynomial.size() > 0){
+                polynomial = add_edge_weights(polynomial, special_slot[edge[0]], special_slot[edge[1]], root);
+            }
+        }
+        
+        // (3.3) factors of the special vertices, which need their own residue
+        boost::multiprecision::cpp_int value = 0;
+        for (total_polynomial::const_iterator it = polynomial.begin(); it != polynomial.end(); it++){
+            boost::multiprecision::cpp_int weight = it->second;
+            for (int j = 0; j < number_of_vertices; j++){
+                if (special_slot[j] >= 0){
+                    int f = it->first[special_slot[j]];
+                    weight *= ((f - degrees[j]) % root == 0) ? root * root - ((f >= degrees[j]) ? 1 : 0) : 0;
+                }
+            }
+            value += weight;
+        }
+        total += leaf->second * value;
+        
+    }
+    return factor * total;
+    
+}
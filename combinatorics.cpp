@@ -103,3 +103,26 @@ boost::multiprecision::int128_t number_partitions(
     // return final result
     return count;    
 }
+
+
+
+// Task: Tabulate the number of partitions of f into exactly n integers w1, ..., wn with 1 <= w1, ..., wn < r.
+// Output: table[n][f] = number_partitions(f, n, r) for 0 <= n <= max_n and 0 <= f <= max_n * (r-1).
+std::vector<std::vector<boost::multiprecision::int128_t>> number_partitions_table(
+        const int & max_n,
+        const int & r)
+{
+    
+    int max_f = max_n * (r - 1);
+    std::vector<std::vector<boost::multiprecision::int128_t>> table(max_n + 1, std::vector<boost::multiprecision::int128_t>(max_f + 1, 0));
+    table[0][0] = 1;
+    for (int n = 1; n <= max_n; n++){
+        for (int f = n; f <= n * (r - 1); f++){
+            for (int i = 1; i < r && i <= f; i++){
+                table[n][f] += table[n-1][f-i];
+            }
+        }
+    }
+    return table;
+    
+}
@@ -1,93 +1,137 @@
-// method to check if a vector contains an element
-template <typename T>
-bool contains(const std::vector<T> & vec, const T & elem)
+// Adjacency of a multigraph in compressed form: the neighbours of vertex v, in the order of their first edge, are
+// neighbours[offsets[v]], ..., neighbours[offsets[v+1]-1], and multiplicities holds the number of edge ends between
+// v and each of them (a loop counts twice, once per end)
+struct adjacency_multiplicity{
+    std::vector<int> offsets;
+    std::vector<int> neighbours;
+    std::vector<int> multiplicities;
+};
+
+
+// method to compile the adjacency in O(vertices + edges)
+adjacency_multiplicity compile_adjacency(const std::vector<std::vector<int>> & edges, const int & number_of_vertices)
 {
-    bool result = false;
-    if(std::find(vec.begin(), vec.end(), elem) != vec.end())
-    {
-        result = true;
+    
+    // (1) incident edges of every vertex in the order of the edge list (counting sort by end point)
+    std::vector<int> incidence_offsets(number_of_vertices + 1, 0);
+    for (int i = 0; i < edges.size(); i++){
+        incidence_offsets[edges[i][0] + 1]++;
+        incidence_offsets[edges[i][1] + 1] += (edges[i][1] != edges[i][0]) ? 1 : 0;
     }
-    return result;
+    std::partial_sum(incidence_offsets.begin(), incidence_offsets.end(), incidence_offsets.begin());
+    std::vector<int> incidences(incidence_offsets.back());
+    std::vector<int> fill(incidence_offsets.begin(), incidence_offsets.end() - 1);
+    for (int i = 0; i < edges.size(); i++){
+        incidences[fill[edges[i][0]]++] = i;
+        if (edges[i][1] != edges[i][0]){
+            incidences[fill[edges[i][1]]++] = i;
+        }
+    }
+    
+    // (2) merge the parallel edges into neighbours with multiplicities (position marks the neighbours seen so far)
+    adjacency_multiplicity adjacency;
+    adjacency.offsets.push_back(0);
+    std::vector<int> position(number_of_vertices, -1);
+    for (int v = 0; v < number_of_vertices; v++){
+        for (int p = incidence_offsets[v]; p < incidence_offsets[v+1]; p++){
+            const std::vector<int> & edge = edges[incidences[p]];
+            int other = (edge[0] == v) ? edge[1] : edge[0];
+            if (position[other] < 0){
+                position[other] = adjacency.neighbours.size();
+                adjacency.neighbours.push_back(other);
+                adjacency.multiplicities.push_back(0);
+            }
+            adjacency.multiplicities[position[other]] += (other == v) ? 2 : 1;
+        }
+        for (int p = adjacency.offsets.back(); p < adjacency.neighbours.size(); p++){
+            position[adjacency.neighbours[p]] = -1;
+        }
+        adjacency.offsets.push_back(adjacency.neighbours.size());
+    }
+    return adjacency;
+    
 }
 
+
 // method to compute new graph_information
+// The vertices are eliminated in index order (level k belongs to vertex k, which the counting relies on) until no edges
+// are left; vertices without remaining edges give empty levels. Edges with an end point outside 0, ..., edge_numbers.size()-1
+// are reported and ignored. The cost is linear in the number of vertices and edges.
 void additional_graph_information(
                                   const std::vector<std::vector<int>> & edges,
                                   std::vector<int> & edge_numbers,
                                   std::vector<std::vector<std::vector<int>>> & graph_stratification )
 {
     
-    // compute the edge_numbers
+    // validate the edges
+    int number_of_vertices = edge_numbers.size();
+    std::vector<std::vector<int>> valid_edges;
+    valid_edges.reserve(edges.size());
     for (int i = 0; i < edges.size(); i++){
-        edge_numbers[edges[i][0]]++;
-        edge_numbers[edges[i][1]]++;
+        if (edges[i].size() != 2 || std::min(edges[i][0], edges[i][1]) < 0 || std::max(edges[i][0], edges[i][1]) >= number_of_vertices){
+            std::cerr << "Edge " << i << " does not connect two of the " << number_of_vertices << " vertices, ignored\n";
+            continue;
+        }
+        valid_edges.push_back(edges[i]);
     }
     
-    // compute the graph_stratification
-    bool test = true;
+    // compute the edge_numbers
+    for (int i = 0; i < valid_edges.size(); i++){
+        edge_numbers[valid_edges[i][0]]++;
+        edge_numbers[valid_edges[i][1]]++;
+    }
+    
+    // compute the graph_stratification: eliminating vertex k leaves its neighbours with index >= k (and their
+    // multiplicities) and removes its edges from the remaining edge ends of these neighbours
+    adjacency_multiplicity adjacency = compile_adjacency(valid_edges, std::max(number_of_vertices, 1));
+    std::vector<int> remaining(edge_numbers.begin(), edge_numbers.end());
+    int remaining_edges = valid_edges.size();
     int index = 0;
-    std::vector<std::vector<int>> scan_edges(edges.begin(), edges.end());
-    while (test) {
-        
-        // determine the vertices connected to the index-th vertex
-        std::vector<int> connected_vertices;
-        for (int i = 0; i < scan_edges.size(); i++){
-            if (scan_edges[i][0] == index && contains(connected_vertices, scan_edges[i][1]) == false){
-                connected_vertices.push_back(scan_edges[i][1]);
-            }
-            if (scan_edges[i][1] == index && contains(connected_vertices, scan_edges[i][0]) == false){
-                connected_vertices.push_back(scan_edges[i][0]);
-            }
-        }
-        
-        // determine the number of connecting edges
-        std::vector<int> number_of_connecting_edges(connected_vertices.size(),0);
-        for (int i = 0; i < connected_vertices.size(); i++){
-            for (int j = 0; j < scan_edges.size(); j++){
-                if (scan_edges[j][0] == index && scan_edges[j][1] == connected_vertices[i]){
-                    number_of_connecting_edges[i]++;
-                }
-                if (scan_edges[j][1] == index && scan_edges[j][0] == connected_vertices[i]){
-                    number_of_connecting_edges[i]++;
-                }
-            }
-        }
-        
-        // determine the number of remaining edges for all connected
-        std::vector<int> remaining_edges(connected_vertices.size(),0);
-        for (int i = 0; i < connected_vertices.size(); i++){
-            for (int j = 0; j < scan_edges.size(); j++){
-                if (scan_edges[j][0] != index && scan_edges[j][1] == connected_vertices[i]){
-                    remaining_edges[i]++;
-                }
-                if (scan_edges[j][1] != index && scan_edges[j][0] == connected_vertices[i]){
-                    remaining_edges[i]++;
-                }
-            }
-        }
-        
-        // add data to graph_stratification
-        graph_stratification.push_back({connected_vertices, number_of_connecting_edges, remaining_edges});
-        
-        // compute new list of edges
-        std::vector<std::vector<int>> new_edges;
-        for (int i = 0; i < scan_edges.size(); i++){
-            if (scan_edges[i][0] != index && scan_edges[i][1] != index){
-                new_edges.push_back(scan_edges[i]);
+    do {
+        std::vector<int> connected_vertices, number_of_connecting_edges, remaining_after;
+        int other_edges = 0;
+        for (int p = adjacency.offsets[index]; p < adjacency.offsets[index+1]; p++){
+            int neighbour = adjacency.neighbours[p];
+            if (neighbour < index){
+                continue;
             }
+            int multiplicity = adjacency.multiplicities[p];
+            remaining[neighbour] -= multiplicity;
+            remaining_edges -= (neighbour == index) ? multiplicity / 2 : multiplicity;
+            other_edges += (neighbour == index) ? 0 : multiplicity;
+            connected_vertices.push_back(neighbour);
+            number_of_connecting_edges.push_back(multiplicity);
         }
-        
-        // check if we are done: are there no remaining edges?
-        if (new_edges.size() == 0){
-            // yes -> end while loop
-            test = false;
+        for (int neighbour : connected_vertices){
+            // (a loop makes the vertex its own neighbour, with its other edges as remaining edges as before)
+            remaining_after.push_back((neighbour == index) ? other_edges : remaining[neighbour]);
         }
-        else{
-            // not yet done -> prepare for next iteration
-            index++;
-            scan_edges = new_edges;
+        graph_stratification.push_back({connected_vertices, number_of_connecting_edges, remaining_after});
+        index++;
+    } while (remaining_edges > 0 && index < number_of_vertices);
+    
+}
+
+
+
+// method to compile the graph_stratification into one contiguous array of steps with offsets per level
+graph_plan compile_graph_plan(const std::vector<std::vector<std::vector<int>>> & graph_stratification)
+{
+    
+    graph_plan plan;
+    plan.max_connecting_edges = 0;
+    plan.level_offsets.push_back(0);
+    for (int k = 0; k < graph_stratification.size(); k++){
+        for (int j = 0; j < graph_stratification[k][0].size(); j++){
+            stratification_step step;
+            step.vertex = graph_stratification[k][0][j];
+            step.connecting_edges = graph_stratification[k][1][j];
+            step.remaining_edges = graph_stratification[k][2][j];
+            plan.steps.push_back(step);
+            plan.max_connecting_edges = std::max(plan.max_connecting_edges, step.connecting_edges);
         }
-        
+        plan.level_offsets.push_back(plan.steps.size());
     }
+    return plan;
     
 }
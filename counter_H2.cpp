@@ -1,30 +1,28 @@
 #include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <functional>
+#include <memory>
 #include<fstream>
 #include<iostream>
-#include <mutex>
 #include <numeric>
 #include <sstream>
-#include <stack>
-#include <thread>
 #include <vector>
+#include <unistd.h>
+#include <zlib.h>
 #include <boost/multiprecision/cpp_int.hpp>
-#include <boost/thread/mutex.hpp>
-#include <boost/thread/thread.hpp>
-#include "compute_graph_information.cpp"
-
-// guards for thread-safe operations
-boost::mutex myGuard;
-bool display_details = true;
-#include "rootCounter-v2.cpp"
+#include "rootCounter.h"
+#include "driver_options.cpp"
+#include "flux_schedule.cpp"
+#include "flux_archive.cpp"
 
 // Optimizations for speedup
 #pragma GCC optimize("Ofast")
-#pragma GCC target("avx,avx2,fma")
 
 // Global variables
-int thread_number = 8;
+int thread_number = 0; // set in main: --threads=<n>, otherwise detected from the hardware and the cgroup CPU quota
+driver_options options;
 
 // read out fluxes
 std::vector<std::vector<int>> read_fluxes(const int & file_number, const int & start, const int & end)
@@ -33,18 +31,22 @@ std::vector<std::vector<int>> read_fluxes(const int & file_number, const int & s
     // create file_name
     std::string file_name = "data_H2/fluxes_H2_" + std::to_string(file_number);
     
-    // can be open the file?
+    // can be open the file? otherwise stream it out of the zip archives
     std::ifstream in(file_name.c_str());
+    std::unique_ptr<flux_archive_reader> archive;
     if(in.fail()){
-        std::cout << "File " << file_name.c_str() << " not found \n";
+        archive = open_flux_archive({"data_H2/fluxes_H2_part1.zip", "data_H2/fluxes_H2_part2.zip"}, "fluxes_H2_" + std::to_string(file_number), start);
+        if (!archive){
+            std::cout << "File " << file_name.c_str() << " not found \n";
+        }
     }
     
     // reserve a string
     std::string s;
     s.reserve(15);
-        
-    // skip as many lines as specified by variable start
-    for(int j = 0; j < start; j++){
+    
+    // skip as many lines as specified by variable start (the archive starts there)
+    for(int j = 0; j < start && !archive; j++){
         std::getline(in, s);
     }
     
@@ -53,7 +55,12 @@ std::vector<std::vector<int>> read_fluxes(const int & file_number, const int & s
     for(int i = start; i <= end; i++){
         
         // the get line
-        std::getline(in,s);
+        if (archive){
+            archive->getline(s);
+        }
+        else{
+            std::getline(in,s);
+        }
         
         // cast the string s into a vector
         std::vector<int> flux;
@@ -88,7 +95,7 @@ std::vector<std::vector<int>> read_fluxes(const int & file_number, const int & s
 // determine root distribution for given outflux
 void count_roots(const int & file_number, const int & start, const int & end)
 {
-
+    
     // (0) hard coded information for diagram 88
     int h0Max = 4;
     int root = 20;
@@ -97,52 +104,148 @@ void count_roots(const int & file_number, const int & start, const int & end)
     std::vector<int> genera = {0,1,0,0,0};
     std::vector<std::vector<int>> edges = {{4,0},{0,3},{2,3},{2,4},{0,1},{1,4},{1,3},{1,2},{1,2}};
     
-    // (1) compute additional information about this diagram
-    std::vector<int> edge_numbers(degrees.size(),0);
-    std::vector<std::vector<std::vector<int>>> graph_stratification;
-    additional_graph_information(edges, edge_numbers, graph_stratification);
+    // (1) compute additional information about this diagram (shared by all fluxes)
+    std::shared_ptr<RootCountGraph> graph = std::make_shared<RootCountGraph>(edges, degrees.size());
+    RootCountThreadPool pool(thread_number - 1, options.pin_threads);
+    graph->replicate(pool);
     
     // (2) read fluxes
     std::vector<std::vector<int>> fluxes = read_fluxes(file_number, start, end);
     
-    // (3) for each flux, compute the distribution
-    std::vector<std::vector<int>> non_trivial_fluxes;
-    std::vector<std::vector<boost::multiprecision::int128_t>> non_trivial_distributions;
+    // (2.5) report progress to a status file (if requested; the counters are also used for the cost log)
+    std::unique_ptr<RootCountProgress> progress;
+    if (options.status_file != "" || options.cost_log != ""){
+        progress.reset(new RootCountProgress(options.status_file, options.status_interval, thread_number));
+    }
+    
+    // (2.6) compute the "reduced" degrees
+    std::vector<std::vector<int>> reduced_degrees(fluxes.size(), degrees);
     for (int i = 0; i < fluxes.size(); i++){
-        
-        // (3.0) print status
-        std::cout << "Status: " << i << '\r';
-        
-        // (3.1) compute the "reduced" degrees
         for (int j = 0; j < degrees.size(); j++){
-            degrees[j] -= fluxes[i][j];
+            reduced_degrees[i][j] -= fluxes[i][j];
+        }
+    }
+    
+    // (2.7) cut the fluxes into batches of consecutive fluxes (which share the outflux enumeration and the counts of common
+    // outfluxes), predict their costs and schedule the batches of this shard, heaviest first
+    std::vector<std::vector<int>> batch_indices;
+    std::vector<RootCountBatch> batches;
+    for (int first = 0; first < fluxes.size(); first += options.batch_size){
+        std::vector<int> indices;
+        std::vector<std::vector<int>> batch_degrees;
+        for (int i = first; i < std::min(first + options.batch_size, (int) fluxes.size()); i++){
+            indices.push_back(i);
+            batch_degrees.push_back(reduced_degrees[i]);
+        }
+        batch_indices.push_back(indices);
+        batches.push_back(RootCountBatch(graph, genus, batch_degrees, genera, root));
+    }
+    std::vector<double> costs(batches.size(), 0);
+    if (options.order_by_cost || options.shards > 1){
+        for (int b = 0; b < batches.size(); b++){
+            std::vector<double> flux_costs = batches[b].predicted_costs(h0Max);
+            costs[b] = std::accumulate(flux_costs.begin(), flux_costs.end(), 0.0);
         }
+    }
+    std::vector<int> scheduled = schedule_batches(costs, options.order_by_cost, options.shards, options.shard);
+    if (progress){
+        long long scheduled_fluxes = 0;
+        for (int b : scheduled){
+            scheduled_fluxes += batch_indices[b].size();
+        }
+        progress->set_fluxes_total(scheduled_fluxes);
+    }
+    
+    // (3) compute the distributions batch by batch
+    std::vector<std::vector<boost::multiprecision::cpp_int>> distributions(fluxes.size());
+    std::vector<std::vector<RootCountEstimate>> estimates(fluxes.size());
+    int fluxes_done = 0;
+    bool total_check_notice = false;
+    for (int b : scheduled){
+        const std::vector<int> & indices = batch_indices[b];
+        std::chrono::steady_clock::time_point batch_start = std::chrono::steady_clock::now();
+        long long states_before = progress ? progress->states_visited() : 0;
         
-        // (3.2) compute distribution on H1
-        std::vector<boost::multiprecision::int128_t> dist(h0Max + 1, 0);
-        int h0_min = (int)(std::accumulate(degrees.begin(),degrees.end(),0)/root) - genus + 1;
-        if (h0_min < 0){
-            h0_min = 0;
-        }        
-        for (int j = 0; j <= h0Max; j++){
-            dist[j] = parallel_root_counter(genus, degrees, genera, edges, root, graph_stratification, edge_numbers, j, thread_number);
+        // (3.0) print status (unless it goes to the status file)
+        if (options.status_file == ""){
+            std::cout << "Status: " << fluxes_done << '\r';
         }
         
-        // (3.3) remember non-trivial results
-        bool zeros = std::all_of(dist.begin(), dist.end(), [](boost::multiprecision::int128_t j) { return j==0; });
-        if (!zeros){
-            non_trivial_fluxes.push_back(fluxes[i]);
-            non_trivial_distributions.push_back(dist);
+        // (3.1) only estimate the distributions on H2, to decide if an exact run is worthwhile
+        if (options.estimate_seconds > 0){
+            for (int i : indices){
+                RootCountProblem problem(graph, genus, reduced_degrees[i], genera, root);
+                problem.set_progress(progress.get());
+                estimates[i].assign(h0Max + 1, RootCountEstimate());
+                for (int j = problem.h0_min(); j <= h0Max; j++){
+                    estimates[i][j] = problem.estimate(j, options.estimate_seconds / (h0Max + 1 - problem.h0_min()), &pool);
+                }
+            }
+        }
+        
+        // (3.2) compute the distributions on H2
+        else{
+            RootCountBatch & batch = batches[b];
+            batch.set_progress(progress.get());
+            batch.set_frontier_memory(options.frontier_memory);
+            std::vector<std::vector<boost::multiprecision::cpp_int>> dists = batch.distributions(h0Max, &pool, options.engine, options.total == "derive");
+            for (int j = 0; j < indices.size(); j++){
+                distributions[indices[j]] = dists[j];
+            }
+            
+            // check the distributions against the total where all buckets are counted (catches e.g. int128 overflows)
+            std::vector<int> tops = batch.h0_tops();
+            if (options.total == "check" && *std::min_element(tops.begin(), tops.end()) <= h0Max){
+                std::vector<boost::multiprecision::cpp_int> totals = batch.totals();
+                if (!total_check_notice && *std::min_element(totals.begin(), totals.end()) < 0){
+                    std::cout << "Total check disabled for this diagram where no closed-form total is available (too many edges or terms)\n";
+                    total_check_notice = true;
+                }
+                for (int j = 0; j < indices.size(); j++){
+                    boost::multiprecision::cpp_int sum = std::accumulate(dists[j].begin(), dists[j].end(), (boost::multiprecision::cpp_int) 0);
+                    if (tops[j] <= h0Max && totals[j] >= 0 && sum != totals[j]){
+                        std::cout << "Total check failed for flux " << start + indices[j] << ": counted " << sum << ", expected " << totals[j] << "\n";
+                        std::ofstream ofile("results_H2/failed_checks_H2_" + std::to_string(file_number), std::ios_base::app);
+                        ofile << start + indices[j] << "," << sum << "," << totals[j] << "\n";
+                    }
+                }
+            }
         }
         
+        // (3.3) log the predicted against the actual cost
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batch_start).count();
+        log_cost(options.cost_log, indices, costs[b], progress ? progress->states_visited() - states_before : 0, seconds);
+        
         // 3.5 flush line
+        fluxes_done += indices.size();
+        if (progress){
+            progress->flux_done(indices.size());
+        }
         std::cout.flush();
         
     }
     
-    // (4) print non-trivial fluxes
+    // (3.6) remember non-trivial results (in file order)
+    std::vector<std::vector<int>> non_trivial_fluxes;
+    std::vector<std::vector<boost::multiprecision::cpp_int>> non_trivial_distributions;
+    std::vector<std::vector<RootCountEstimate>> non_trivial_estimates;
+    for (int i = 0; i < fluxes.size(); i++){
+        bool zeros = std::all_of(distributions[i].begin(), distributions[i].end(), [](const boost::multiprecision::cpp_int & j) { return j==0; });
+        if (!zeros){
+            non_trivial_fluxes.push_back(fluxes[i]);
+            non_trivial_distributions.push_back(distributions[i]);
+        }
+        zeros = std::all_of(estimates[i].begin(), estimates[i].end(), [](const RootCountEstimate & j) { return j.estimate==0; });
+        if (!zeros){
+            non_trivial_fluxes.push_back(fluxes[i]);
+            non_trivial_estimates.push_back(estimates[i]);
+        }
+    }
+    
+    // (4) print non-trivial fluxes (in estimate mode: the fluxes for which an exact run is worthwhile)
+    std::string prefix = (options.estimate_seconds > 0) ? "estimated_" : "";
     std::ofstream ofile;
-    ofile.open("results_H2/good_fluxes_H2_" + std::to_string(file_number), std::ios_base::app);
+    ofile.open("results_H2/" + prefix + "good_fluxes_H2_" + std::to_string(file_number), std::ios_base::app);
     for (int i = 0; i < non_trivial_fluxes.size(); i++){
         for (int j = 0; j < non_trivial_fluxes[i].size() -1; j ++){
             ofile << non_trivial_fluxes[i][j] << ",";
@@ -150,15 +253,21 @@ void count_roots(const int & file_number, const int & start, const int & end)
         ofile << non_trivial_fluxes[i][non_trivial_fluxes[i].size()-1] << "\n";
     }
     ofile.close();
-
-    // (5) print non-trivial distributions
-    ofile.open("results_H2/distribution_H2_" + std::to_string(file_number), std::ios_base::app);
+    
+    // (5) print non-trivial distributions (in estimate mode: estimate:lower:upper for each h0)
+    ofile.open("results_H2/" + prefix + "distribution_H2_" + std::to_string(file_number), std::ios_base::app);
     for (int i = 0; i < non_trivial_distributions.size(); i++){
         for (int j = 0; j < non_trivial_distributions[i].size() -1; j ++){
             ofile << non_trivial_distributions[i][j] << ",";
         }
         ofile << non_trivial_distributions[i][non_trivial_distributions[i].size()-1] << "\n";
     }
+    for (int i = 0; i < non_trivial_estimates.size(); i++){
+        for (int j = 0; j < non_trivial_estimates[i].size(); j ++){
+            ofile << non_trivial_estimates[i][j].estimate << ":" << non_trivial_estimates[i][j].lower << ":" << non_trivial_estimates[i][j].upper;
+            ofile << ((j < non_trivial_estimates[i].size() - 1) ? "," : "\n");
+        }
+    }
     ofile.close();
     
 }
@@ -172,12 +281,18 @@ void count_roots(const int & file_number, const int & start, const int & end)
 int main(int argc, char* argv[]) {
     
     // check if we have the correct number of arguments
-    if (argc != 2) {
-        std::cout << "Error - number of arguments must be exactly 1 and not " << argc << "\n";
+    if (argc < 2) {
+        std::cout << "Error - number of arguments must be at least 1 and not " << argc - 1 << "\n";
         std::cout << argv[ 0 ] << "\n";
         return 0;
     }
     
+    // parse optional arguments
+    if (!parse_driver_options(argc, argv, 2, options)){
+        return -1;
+    }
+    thread_number = (options.threads > 0) ? options.threads : detect_thread_number();
+    
     // parse input
     std::string myString = argv[1];
     std::stringstream iss( myString );
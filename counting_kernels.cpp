@@ -0,0 +1,328 @@
+// Counting kernels: the depth-first search over the weight assignments of one outflux (bounds of the flux partitions,
+// feasibility checks and accumulation of the multiplicities), and the steps of one level which all engines share.
+// This file is included once per instruction set into its own namespace (see cpu_dispatch.cpp), together with the
+// combinatorics it calls, so that every variant is compiled for its target.
+
+#include "combinatorics.cpp"
+
+
+// Task: Bounds of the flux partitions of level k of the plan for the residual flux, i.e. of the weights on the edges from
+// the vertex of level k to the later vertices, left by the residual fluxes of these vertices.
+// Output: false if level k assigns nothing (no residual flux and no edges), the state then moves on to level k+1 unchanged
+bool level_bounds(
+                                const int root,
+                                const graph_plan & plan,
+                                const int k,
+                                const std::vector<int> & flux,
+                                std::vector<int> & minima,
+                                std::vector<int> & maxima )
+{
+    const stratification_step * steps = plan.level(k);
+    int n = plan.level_size(k);
+    if (flux[k] == 0 && n == 0){
+        return false;
+    }
+    minima.clear();
+    maxima.clear();
+    for (int j = 0; j < n; j++){
+        int min = steps[j].connecting_edges;
+        int f_other = flux[steps[j].vertex];
+        if (min < steps[j].connecting_edges * root - (f_other - steps[j].remaining_edges)){
+            min = steps[j].connecting_edges * root - (f_other - steps[j].remaining_edges);
+        }
+        minima.push_back(min);
+        maxima.push_back(steps[j].connecting_edges * (root-1));
+    }
+    return true;
+}
+
+
+// Task: Flux partitions of level k of the plan for the residual flux (within the bounds of level_bounds).
+// Output: false if level k assigns nothing (no residual flux and no edges), the state then moves on to level k+1 unchanged
+bool level_partitions(
+                                const int root,
+                                const graph_plan & plan,
+                                const int k,
+                                const std::vector<int> & flux,
+                                std::vector<int> & minima,
+                                std::vector<int> & maxima,
+                                std::vector<std::vector<int>> & flux_partitions )
+{
+    flux_partitions.clear();
+    if (!level_bounds(root, plan, k, flux, minima, maxima)){
+        return false;
+    }
+    comp_partitions(flux[k], plan.level_size(k), minima, maxima, flux_partitions);
+    return true;
+}
+
+
+// Task: Residual flux on level k+1 after the flux partition of level k.
+void apply_level_partition(
+                                const int root,
+                                const graph_plan & plan,
+                                const int k,
+                                const std::vector<int> & flux_partition,
+                                std::vector<int> & flux )
+{
+    const stratification_step * steps = plan.level(k);
+    int n = plan.level_size(k);
+    flux[k] = 0;
+    for (int a = 0; a < n; a++){
+        flux[steps[a].vertex] -= root * steps[a].connecting_edges - flux_partition[a];
+    }
+}
+
+
+// Task: Factor of the genus one vertices for the h0 partition (root^2 - 1 if h = 0 at the vertex, root^2 otherwise).
+boost::multiprecision::int128_t genus_factor(
+                                const std::vector<int> & genera,
+                                const int root,
+                                const std::vector<int> & partition )
+{
+    boost::multiprecision::int128_t factor = 1;
+    for (int j = 0; j < genera.size(); j++){
+        if ((genera[j] == 1) and (partition[j] == 0)){
+            factor *= (boost::multiprecision::int128_t) (root * root - 1);
+        }
+        if ((genera[j] == 1) and (partition[j] > 0)){
+            factor *= (boost::multiprecision::int128_t) (root * root);
+        }
+    }
+    return factor;
+}
+
+
+// Task: Factor of the genus one vertices for the h0 partition modulo p.
+uint64_t genus_factor_mod(
+                                const std::vector<int> & genera,
+                                const int root,
+                                const std::vector<int> & partition,
+                                const uint64_t p )
+{
+    uint64_t factor = 1 % p;
+    for (int j = 0; j < genera.size(); j++){
+        if ((genera[j] == 1) and (partition[j] == 0)){
+            factor = mul_mod(factor, (uint64_t) (root * root - 1), p);
+        }
+        if ((genera[j] == 1) and (partition[j] > 0)){
+            factor = mul_mod(factor, (uint64_t) (root * root), p);
+        }
+    }
+    return factor;
+}
+
+
+// Count the weight assignments of one outflux, times the genus factor of its h0 partition
+boost::multiprecision::int128_t count_outflux(
+                                const std::vector<int> & genera,
+                                const int root,
+                                const graph_plan & plan,
+                                const std::vector<int> & outflux,
+                                const std::vector<int> & partition,
+                                progress_counters * counters )
+{
+    
+    // save total number of roots found
+    boost::multiprecision::int128_t total = 0;
+    
+    // count weight assignments
+    struct comb_data{
+        std::vector<int> flux;
+        int k;
+        boost::multiprecision::int128_t mult;
+    };
+    std::vector<int> minima, maxima;
+    std::vector<std::vector<int>> flux_partitions;
+    boost::multiprecision::int128_t factor = genus_factor(genera, root, partition);
+    long long pending_states = 0;
+    
+    // create stack
+    std::stack<comb_data> snapshotStack;
+    
+    // add first snapshot
+    comb_data currentSnapshot;
+    currentSnapshot.flux = outflux;
+    currentSnapshot.k = 0;
+    currentSnapshot.mult = (boost::multiprecision::int128_t) 1;
+    snapshotStack.push(currentSnapshot);
+    
+    // Run...
+    while(!snapshotStack.empty())
+    {
+        
+        // pick the top snapshot and delete it from the stack
+        currentSnapshot= snapshotStack.top();
+        snapshotStack.pop();
+        
+        // report progress from time to time (relaxed atomic add to the own counters, no locks)
+        if (++pending_states == 4096){
+            if (counters != nullptr){
+                counters->states.fetch_add(pending_states, std::memory_order_relaxed);
+            }
+            pending_states = 0;
+        }
+        
+        // action required...
+        if (currentSnapshot.k < plan.number_of_levels()){
+            
+            // compute flux_partitions
+            if (!level_partitions(root, plan, currentSnapshot.k, currentSnapshot.flux, minima, maxima, flux_partitions)){
+                
+                // all weights set, just increase k
+                comb_data newSnapshot;
+                newSnapshot.flux = currentSnapshot.flux;
+                newSnapshot.mult = currentSnapshot.mult;
+                newSnapshot.k = currentSnapshot.k + 1;
+                snapshotStack.push(newSnapshot);
+                
+            }
+            else{
+                
+                // not all weights are determined -> create new snapshots for all flux_partitions
+                const stratification_step * steps = plan.level(currentSnapshot.k);
+                int n = plan.level_size(currentSnapshot.k);
+                for(int j = 0; j < flux_partitions.size(); j++){
+                    
+                    // create data of new snapshot (in particular the number of subpartitions)
+                    boost::multiprecision::int128_t mult = currentSnapshot.mult;
+                    std::vector<int> new_flux(currentSnapshot.flux.begin(), currentSnapshot.flux.end());
+                    apply_level_partition(root, plan, currentSnapshot.k, flux_partitions[j], new_flux);
+                    for (int a = 0; a < n; a++){
+                        mult = mult * number_partitions(flux_partitions[j][a], steps[a].connecting_edges, root);
+                    }
+                    
+                    // add snapshot
+                    comb_data newSnapshot;
+                    newSnapshot.flux = new_flux;
+                    newSnapshot.mult = mult;
+                    newSnapshot.k = currentSnapshot.k + 1;
+                    snapshotStack.push(newSnapshot);
+                    
+                }
+                
+            }
+            
+        }
+        // no action required -> increase total
+        else{
+            total += currentSnapshot.mult * factor;
+        }
+        
+    }
+    
+    // outflux complete
+    if (counters != nullptr){
+        counters->states.fetch_add(pending_states, std::memory_order_relaxed);
+        counters->outfluxes.fetch_add(1, std::memory_order_relaxed);
+    }
+    return total;
+    
+}
+
+
+// Count the weight assignments of one outflux modulo p, times the genus factor of its h0 partition
+uint64_t modular_count_outflux(
+                                const std::vector<int> & genera,
+                                const int root,
+                                const graph_plan & plan,
+                                const std::vector<int> & outflux,
+                                const std::vector<int> & partition,
+                                const uint64_t p,
+                                const std::vector<std::vector<uint64_t>> & partition_table,
+                                progress_counters * counters )
+{
+    
+    // save total number of roots found (mod p)
+    uint64_t total = 0;
+    
+    // count weight assignments
+    struct comb_data{
+        std::vector<int> flux;
+        int k;
+        uint64_t mult;
+    };
+    std::vector<int> minima, maxima;
+    std::vector<std::vector<int>> flux_partitions;
+    uint64_t factor = genus_factor_mod(genera, root, partition, p);
+    long long pending_states = 0;
+    
+    // create stack
+    std::stack<comb_data> snapshotStack;
+    
+    // add first snapshot
+    comb_data currentSnapshot;
+    currentSnapshot.flux = outflux;
+    currentSnapshot.k = 0;
+    currentSnapshot.mult = 1 % p;
+    snapshotStack.push(currentSnapshot);
+    
+    // Run...
+    while(!snapshotStack.empty())
+    {
+        
+        // pick the top snapshot and delete it from the stack
+        currentSnapshot= snapshotStack.top();
+        snapshotStack.pop();
+        
+        // report progress from time to time (relaxed atomic add to the own counters, no locks)
+        if (++pending_states == 4096){
+            if (counters != nullptr){
+                counters->states.fetch_add(pending_states, std::memory_order_relaxed);
+            }
+            pending_states = 0;
+        }
+        
+        // action required...
+        if (currentSnapshot.k < plan.number_of_levels()){
+            
+            // compute flux_partitions
+            if (!level_partitions(root, plan, currentSnapshot.k, currentSnapshot.flux, minima, maxima, flux_partitions)){
+                
+                // all weights set, just increase k
+                currentSnapshot.k++;
+                snapshotStack.push(currentSnapshot);
+                
+            }
+            else{
+                
+                // not all weights are determined -> create new snapshots for all flux_partitions
+                const stratification_step * steps = plan.level(currentSnapshot.k);
+                int n = plan.level_size(currentSnapshot.k);
+                for(int j = 0; j < flux_partitions.size(); j++){
+                    
+                    // create data of new snapshot (in particular the number of subpartitions)
+                    comb_data newSnapshot;
+                    newSnapshot.mult = currentSnapshot.mult;
+                    newSnapshot.flux = currentSnapshot.flux;
+                    apply_level_partition(root, plan, currentSnapshot.k, flux_partitions[j], newSnapshot.flux);
+                    for (int a = 0; a < n; a++){
+                        newSnapshot.mult = mul_mod(newSnapshot.mult, partition_table[steps[a].connecting_edges][flux_partitions[j][a]], p);
+                    }
+                    newSnapshot.k = currentSnapshot.k + 1;
+                    snapshotStack.push(newSnapshot);
+                    
+                }
+                
+            }
+            
+        }
+        // no action required -> increase total
+        else{
+            uint64_t mult = mul_mod(currentSnapshot.mult, factor, p);
+            total += mult;
+            if (total >= p){
+                total -= p;
+            }
+        }
+        
+    }
+    
+    // outflux complete
+    if (counters != nullptr){
+        counters->states.fetch_add(pending_states, std::memory_order_relaxed);
+        counters->outfluxes.fetch_add(1, std::memory_order_relaxed);
+    }
+    return total;
+    
+}
@@ -0,0 +1,194 @@
+// Runtime selection of the instruction set of the counting kernels (see counting_kernels.cpp).
+//
+// The kernels are compiled once per instruction set, each copy in its own namespace. The best variant supported by the
+// CPU (CPUID via __builtin_cpu_supports) is picked when the kernels are used first; ROOTCOUNTER_ISA or set_counting_isa
+// force a variant, e.g. for benchmarks. So one build runs on every x86-64 node and uses AVX-512 where it is available.
+
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw,avx512vl,avx512dq,avx2,avx,fma,bmi,bmi2,popcnt")
+namespace kernels_avx512{
+#include "counting_kernels.cpp"
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx2,avx,fma,bmi,bmi2,popcnt")
+namespace kernels_avx2{
+#include "counting_kernels.cpp"
+}
+#pragma GCC pop_options
+
+#endif
+
+namespace kernels_baseline{
+#include "counting_kernels.cpp"
+}
+
+
+// One variant of the counting kernels
+struct counting_kernels{
+    std::string name;
+    bool supported;
+    boost::multiprecision::int128_t (*count_outflux)(
+                                const std::vector<int> &, const int, const graph_plan &, const std::vector<int> &, const std::vector<int> &, progress_counters * );
+    uint64_t (*modular_count_outflux)(
+                                const std::vector<int> &, const int, const graph_plan &, const std::vector<int> &, const std::vector<int> &,
+                                const uint64_t, const std::vector<std::vector<uint64_t>> &, progress_counters * );
+    bool (*level_bounds)(
+                                const int, const graph_plan &, const int, const std::vector<int> &, std::vector<int> &, std::vector<int> & );
+    bool (*level_partitions)(
+                                const int, const graph_plan &, const int, const std::vector<int> &, std::vector<int> &, std::vector<int> &,
+                                std::vector<std::vector<int>> & );
+    void (*apply_level_partition)(const int, const graph_plan &, const int, const std::vector<int> &, std::vector<int> & );
+    boost::multiprecision::int128_t (*genus_factor)(const std::vector<int> &, const int, const std::vector<int> & );
+};
+
+
+// Task: List the compiled variants, best first.
+const std::vector<counting_kernels> & kernel_variants()
+{
+    static const std::vector<counting_kernels> variants = [](){
+        std::vector<counting_kernels> list;
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+        bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("bmi2");
+        bool avx512 = avx2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512dq");
+        list.push_back({"avx512", avx512, kernels_avx512::count_outflux, kernels_avx512::modular_count_outflux,
+                        kernels_avx512::level_bounds, kernels_avx512::level_partitions, kernels_avx512::apply_level_partition, kernels_avx512::genus_factor});
+        list.push_back({"avx2", avx2, kernels_avx2::count_outflux, kernels_avx2::modular_count_outflux,
+                        kernels_avx2::level_bounds, kernels_avx2::level_partitions, kernels_avx2::apply_level_partition, kernels_avx2::genus_factor});
+#endif
+        list.push_back({"baseline", true, kernels_baseline::count_outflux, kernels_baseline::modular_count_outflux,
+                        kernels_baseline::level_bounds, kernels_baseline::level_partitions, kernels_baseline::apply_level_partition, kernels_baseline::genus_factor});
+        return list;
+    }();
+    return variants;
+}
+
+
+// Task: Find a supported variant by name ("auto" = best supported variant).
+// Output: -1 if the variant is unknown or not supported by this CPU
+int find_kernel_variant(const std::string & isa)
+{
+    const std::vector<counting_kernels> & variants = kernel_variants();
+    for (int i = 0; i < variants.size(); i++){
+        if (variants[i].supported && (isa == "auto" || isa == variants[i].name)){
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+// Index of the selected variant (-1 until the kernels are used first or a variant is forced)
+std::atomic<int> selected_kernel_variant(-1);
+
+
+// Task: Variant of the kernels to use (chosen on first use from ROOTCOUNTER_ISA, otherwise the best supported one).
+const counting_kernels & selected_kernels()
+{
+    int selected = selected_kernel_variant.load(std::memory_order_acquire);
+    if (selected < 0){
+        const char * environment = std::getenv("ROOTCOUNTER_ISA");
+        int forced = (environment != nullptr) ? find_kernel_variant(environment) : -1;
+        if (environment != nullptr && forced < 0){
+            std::cerr << "Instruction set " << environment << " (ROOTCOUNTER_ISA) not supported, using auto\n";
+        }
+        int expected = -1;
+        selected_kernel_variant.compare_exchange_strong(expected, (forced >= 0) ? forced : find_kernel_variant("auto"));
+        selected = selected_kernel_variant.load(std::memory_order_acquire);
+    }
+    return kernel_variants()[selected];
+}
+
+
+bool set_counting_isa(const std::string & isa)
+{
+    int variant = find_kernel_variant(isa);
+    if (variant < 0){
+        return false;
+    }
+    selected_kernel_variant.store(variant, std::memory_order_release);
+    return true;
+}
+
+
+std::string counting_isa()
+{
+    return selected_kernels().name;
+}
+
+
+// Dispatch to the selected variant
+boost::multiprecision::int128_t count_outflux(
+                                const std::vector<int> & genera,
+                                const int root,
+                                const graph_plan & plan,
+                                const std::vector<int> & outflux,
+                                const std::vector<int> & partition,
+                                progress_counters * counters )
+{
+    return selected_kernels().count_outflux(genera, root, plan, outflux, partition, counters);
+}
+
+
+uint64_t modular_count_outflux(
+                                const std::vector<int> & genera,
+                                const int root,
+                                const graph_plan & plan,
+                                const std::vector<int> & outflux,
+                                const std::vector<int> & partition,
+                                const uint64_t p,
+                                const std::vector<std::vector<uint64_t>> & partition_table,
+                                progress_counters * counters )
+{
+    return selected_kernels().modular_count_outflux(genera, root, plan, outflux, partition, p, partition_table, counters);
+}
+
+
+bool level_bounds(
+                                const int root,
+                                const graph_plan & plan,
+                                const int k,
+                                const std::vector<int> & flux,
+                                std::vector<int> & minima,
+                                std::vector<int> & maxima )
+{
+    return selected_kernels().level_bounds(root, plan, k, flux, minima, maxima);
+}
+
+
+bool level_partitions(
+                                const int root,
+                                const graph_plan & plan,
+                                const int k,
+                                const std::vector<int> & flux,
+                                std::vector<int> & minima,
+                                std::vector<int> & maxima,
+                                std::vector<std::vector<int>> & flux_partitions )
+{
+    return selected_kernels().level_partitions(root, plan, k, flux, minima, maxima, flux_partitions);
+}
+
+
+void apply_level_partition(
+                                const int root,
+                                const graph_plan & plan,
+                                const int k,
+                                const std::vector<int> & flux_partition,
+                                std::vector<int> & flux )
+{
+    selected_kernels().apply_level_partition(root, plan, k, flux_partition, flux);
+}
+
+
+boost::multiprecision::int128_t genus_factor(
+                                const std::vector<int> & genera,
+                                const int root,
+                                const std::vector<int> & partition )
+{
+    return selected_kernels().genus_factor(genera, root, partition);
+}
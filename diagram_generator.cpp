@@ -0,0 +1,129 @@
+// Random diagrams for benchmarks: connected nodal curves with the degree and flux constraints of the counters.
+//
+// A diagram has V components (vertices) of genus 0 or 1, which meet in nodes (edges, no loops and at most max_multiplicity
+// edges between two vertices), so its genus is g = E - V + 1 + (number of genus one vertices). As for the hard coded
+// diagrams (e.g. diagram 88 in counter_H2.cpp: c = 12 and root 20), the degrees are c times the canonical degrees
+// 2 g_i - 2 + (number of edges at vertex i), and c (2g - 2) is divisible by the root. Every genus zero vertex has at
+// least three edges, so all degrees are positive. The fluxes are non-negative, at most the degrees and sum to a multiple
+// of the root (the first flux is zero).
+
+
+// Diagram with its fluxes
+struct random_diagram{
+    int genus;
+    int root;
+    std::vector<int> degrees;
+    std::vector<int> genera;
+    std::vector<std::vector<int>> edges;
+    std::vector<std::vector<int>> fluxes;
+};
+
+
+// Task: Smallest multiple c of the canonical degrees with c >= root/2 and c (2g - 2) divisible by the root.
+int canonical_multiple(const int & genus, const int & root)
+{
+    int c = std::max(1, root / 2);
+    while ((c * (2 * genus - 2)) % root != 0){
+        c++;
+    }
+    return c;
+}
+
+
+// Task: Draw a random diagram with the given number of vertices, genus and genus one vertices.
+// Output: false if there is no such diagram (e.g. too many edges for the multiplicity) or none was found
+bool generate_diagram(
+                      const int & vertices,
+                      const int & genus,
+                      const int & max_multiplicity,
+                      const int & genus_one_vertices,
+                      const int & root,
+                      const int & number_of_fluxes,
+                      const uint64_t & seed,
+                      random_diagram & diagram )
+{
+    
+    // (1) number of edges from the genus (at least a spanning tree, at most max_multiplicity edges per pair of vertices)
+    int number_of_edges = genus - 1 + vertices - genus_one_vertices;
+    if (genus < 2 || root < 2 || vertices < 1 || genus_one_vertices < 0 || genus_one_vertices > vertices ||
+        number_of_edges < vertices - 1 || number_of_edges > max_multiplicity * vertices * (vertices - 1) / 2){
+        return false;
+    }
+    std::mt19937_64 generator(seed);
+    diagram.genus = genus;
+    diagram.root = root;
+    for (int attempt = 0; attempt < 1000; attempt++){
+        
+        // (2) genera and a random spanning tree (every vertex is joined to a random earlier vertex in a random order)
+        diagram.genera.assign(vertices, 0);
+        std::fill(diagram.genera.begin(), diagram.genera.begin() + genus_one_vertices, 1);
+        std::shuffle(diagram.genera.begin(), diagram.genera.end(), generator);
+        std::vector<int> order(vertices);
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), generator);
+        std::vector<std::vector<int>> multiplicities(vertices, std::vector<int>(vertices, 0));
+        diagram.edges.clear();
+        for (int i = 1; i < vertices; i++){
+            int u = order[std::uniform_int_distribution<int>(0, i - 1)(generator)];
+            int v = order[i];
+            multiplicities[u][v]++;
+            multiplicities[v][u]++;
+            diagram.edges.push_back({u, v});
+        }
+        
+        // (3) further edges between random pairs of vertices which are not yet joined max_multiplicity times
+        while (diagram.edges.size() < number_of_edges){
+            std::vector<std::vector<int>> pairs;
+            for (int u = 0; u < vertices; u++){
+                for (int v = u + 1; v < vertices; v++){
+                    if (multiplicities[u][v] < max_multiplicity){
+                        pairs.push_back({u, v});
+                    }
+                }
+            }
+            std::vector<int> pair = pairs[std::uniform_int_distribution<int>(0, (int) pairs.size() - 1)(generator)];
+            multiplicities[pair[0]][pair[1]]++;
+            multiplicities[pair[1]][pair[0]]++;
+            diagram.edges.push_back(pair);
+        }
+        
+        // (4) degrees (try again if a genus zero vertex has fewer than three edges)
+        std::vector<int> edge_numbers(vertices, 0);
+        for (const std::vector<int> & edge : diagram.edges){
+            edge_numbers[edge[0]]++;
+            edge_numbers[edge[1]]++;
+        }
+        bool stable = true;
+        for (int j = 0; j < vertices; j++){
+            stable = stable && (diagram.genera[j] == 1 || edge_numbers[j] >= 3);
+        }
+        if (!stable){
+            continue;
+        }
+        int c = canonical_multiple(genus, root);
+        diagram.degrees.clear();
+        for (int j = 0; j < vertices; j++){
+            diagram.degrees.push_back(c * (2 * diagram.genera[j] - 2 + edge_numbers[j]));
+        }
+        
+        // (5) fluxes: random values up to the root (and the degree), the last vertex completes the sum to a multiple of the root
+        diagram.fluxes.assign(1, std::vector<int>(vertices, 0));
+        for (int attempt_flux = 0; attempt_flux < 100 * number_of_fluxes && diagram.fluxes.size() < number_of_fluxes; attempt_flux++){
+            std::vector<int> flux(vertices, 0);
+            int sum = 0;
+            for (int j = 0; j < vertices - 1; j++){
+                flux[j] = std::uniform_int_distribution<int>(0, std::min(root, diagram.degrees[j]))(generator);
+                sum += flux[j];
+            }
+            flux[vertices - 1] = (root - sum % root) % root;
+            if (flux[vertices - 1] <= diagram.degrees[vertices - 1]){
+                diagram.fluxes.push_back(flux);
+            }
+        }
+        diagram.fluxes.resize(std::min((int) diagram.fluxes.size(), number_of_fluxes));
+        return true;
+        
+    }
+    return false;
+    
+}
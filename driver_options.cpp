@@ -0,0 +1,136 @@
+// Options for the drivers, passed after the main input in the form --key=value
+struct driver_options{
+    
+    // counting engine: --engine=int128 (default), --engine=modular (multi-modular arithmetic with CRT reconstruction),
+    // --engine=meet-in-the-middle (aggregation of the DFS states at an automatically chosen level)
+    // or --engine=frontier (aggregation of the states on every level, one level at a time)
+    RootCountEngine engine = RootCountEngine::int128;
+    
+    // memory budget of the frontier engine: --frontier-memory=<MiB> (default 1024, DFS beyond it)
+    size_t frontier_memory = (size_t) 1 << 30;
+    
+    // instruction set of the counting kernels: --isa=auto (default), avx512, avx2 or baseline (applied while parsing)
+    std::string isa = "auto";
+    
+    // Monte Carlo estimate instead of exact count: --estimate=<seconds> (time budget per flux)
+    double estimate_seconds = 0;
+    
+    // number of threads: --threads=<n> (default: detected from the hardware and the cgroup CPU quota)
+    int threads = 0;
+    
+    // pin every thread to one CPU: --pin-threads=1
+    bool pin_threads = false;
+    
+    // number of consecutive fluxes which are counted together: --batch=<n> (default 64)
+    int batch_size = 64;
+    
+    // closed-form total over all h0: --total=check (default, compared with the sum of the buckets if all are counted),
+    // --total=derive (the bucket with the most outfluxes is the total minus the others) or --total=off
+    std::string total = "check";
+    
+    // order of the batches: --order=cost (default, heaviest predicted cost first) or --order=file
+    bool order_by_cost = true;
+    
+    // split the batches into --shards=<n> jobs balanced by predicted cost, of which this is --shard=<k> (0, ..., n-1)
+    int shards = 1;
+    int shard = 0;
+    
+    // log of predicted against actual cost per batch of fluxes: --cost-log=<path>
+    std::string cost_log = "";
+    
+    // machine-readable status file: --status-file=<path>, written every --status-interval=<seconds> (default 10)
+    std::string status_file = "";
+    double status_interval = 10;
+
+};
+
+
+// Task: Parse the optional arguments argv[first], ..., argv[argc-1] into the driver options.
+// Output: false if an argument is not understood.
+bool parse_driver_options(int argc, char* argv[], const int & first, driver_options & options)
+{
+    
+    for (int i = first; i < argc; i++){
+        
+        // split the argument into key and value
+        std::string argument = argv[i];
+        size_t pos = argument.find("=");
+        if (argument.compare(0, 2, "--") != 0 || pos == std::string::npos){
+            std::cout << "Unknown option " << argument << "\n";
+            return false;
+        }
+        std::string key = argument.substr(2, pos - 2);
+        std::string value = argument.substr(pos + 1);
+        
+        // set the option
+        if (key == "engine" && value == "int128"){
+            options.engine = RootCountEngine::int128;
+        }
+        else if (key == "engine" && value == "modular"){
+            options.engine = RootCountEngine::modular;
+        }
+        else if (key == "engine" && value == "meet-in-the-middle"){
+            options.engine = RootCountEngine::meet_in_the_middle;
+        }
+        else if (key == "engine" && value == "frontier"){
+            options.engine = RootCountEngine::frontier;
+        }
+        else if (key == "frontier-memory" && std::atof(value.c_str()) > 0){
+            options.frontier_memory = (size_t) (std::atof(value.c_str()) * (1 << 20));
+        }
+        else if (key == "isa"){
+            if (!set_counting_isa(value)){
+                std::cout << "Instruction set " << value << " not supported on this CPU\n";
+                return false;
+            }
+            options.isa = value;
+        }
+        else if (key == "estimate" && std::atof(value.c_str()) > 0){
+            options.estimate_seconds = std::atof(value.c_str());
+        }
+        else if (key == "threads" && std::atoi(value.c_str()) > 0){
+            options.threads = std::atoi(value.c_str());
+        }
+        else if (key == "pin-threads" && (value == "0" || value == "1")){
+            options.pin_threads = (value == "1");
+        }
+        else if (key == "batch" && std::atoi(value.c_str()) > 0){
+            options.batch_size = std::atoi(value.c_str());
+        }
+        else if (key == "total" && (value == "check" || value == "derive" || value == "off")){
+            options.total = value;
+        }
+        else if (key == "order" && (value == "cost" || value == "file")){
+            options.order_by_cost = (value == "cost");
+        }
+        else if (key == "shards" && std::atoi(value.c_str()) > 0){
+            options.shards = std::atoi(value.c_str());
+        }
+        else if (key == "shard" && std::atoi(value.c_str()) >= 0 && value.find_first_not_of("0123456789") == std::string::npos){
+            options.shard = std::atoi(value.c_str());
+        }
+        else if (key == "cost-log" && value != ""){
+            options.cost_log = value;
+        }
+        else if (key == "status-file" && value != ""){
+            options.status_file = value;
+        }
+        else if (key == "status-interval" && std::atof(value.c_str()) > 0){
+            options.status_interval = std::atof(value.c_str());
+        }
+        else{
+            std::cout << "Unknown option " << argument << "\n";
+            return false;
+        }
+        
+    }
+    
+    // check the shard
+    if (options.shard >= options.shards){
+        std::cout << "Invalid shard " << options.shard << " of " << options.shards << " shards\n";
+        return false;
+    }
+    
+    return true;
+    
+}
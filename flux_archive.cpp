@@ -0,0 +1,443 @@
+// Reading of the flux files straight out of the zip archives (data_H1/fluxes_H1.zip, data_H2/fluxes_H2_part*.zip),
+// so that they need not be extracted to disk.
+//
+// A member is decompressed by a background thread while the fluxes are parsed. To start at a given line without
+// decompressing everything before it, an index of access points is kept next to the archive (one file per member, e.g.
+// data_H1/fluxes_H1_3.index). About every flux_index_spacing bytes of output, at the end of a deflate block, it records
+// the position in the compressed data, the number of lines before this point and the last 32 KiB of output (the
+// dictionary needed to resume inflating there). The index is built by the first job which does not start at line 0.
+
+
+// Distance of the access points in bytes of decompressed data
+const long long flux_index_spacing = 1 << 20;
+
+
+// Size of the deflate dictionary
+const size_t flux_window_size = 32768;
+
+
+// Number of decompressed chunks (of flux_chunk_size bytes) which the background thread may keep ahead of the parser
+const size_t flux_chunks_ahead = 4;
+const size_t flux_chunk_size = 1 << 18;
+
+
+// One file in a zip archive
+struct flux_archive_member{
+    std::string archive;
+    std::string name;
+    int method;                     // 0 = stored, 8 = deflate
+    long long data_offset;          // start of the compressed data in the archive
+    long long compressed_size;
+    long long uncompressed_size;
+    uint32_t crc;
+};
+
+
+// Point from which a member can be decompressed
+struct flux_access_point{
+    long long out;                  // offset in the decompressed data
+    long long in;                   // offset in the compressed data (of the first full byte after the point)
+    int bits;                       // number of bits of the byte before "in" which belong to the next block
+    long long lines;                // number of line ends before "out"
+    std::string window;             // last (up to) 32 KiB of decompressed data before "out"
+};
+
+
+// Task: Read a little endian number from a buffer.
+uint32_t zip_number(const std::string & buffer, const size_t & position, const int & bytes)
+{
+    uint32_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--){
+        value = (value << 8) | (unsigned char) buffer[position + i];
+    }
+    return value;
+}
+
+
+// Task: Find the member "name" (ignoring directories within the archive) in the first archive which contains it.
+// Output: false if no archive contains the member (or it uses zip64 or a compression other than deflate)
+bool find_archive_member(const std::vector<std::string> & archives, const std::string & name, flux_archive_member & member)
+{
+    for (const std::string & archive : archives){
+        
+        // (1) read the end of the archive
+        std::ifstream in(archive.c_str(), std::ios::binary);
+        if (in.fail()){
+            continue;
+        }
+        in.seekg(0, std::ios::end);
+        long long size = in.tellg();
+        long long tail = std::min(size, 65557LL);
+        std::string buffer(tail, '\0');
+        in.seekg(size - tail);
+        in.read(&buffer[0], tail);
+        
+        // (2) locate the end of central directory record (followed by a comment of at most 64 KiB)
+        long long end_record = -1;
+        for (long long i = tail - 22; i >= 0; i--){
+            if (zip_number(buffer, i, 4) == 0x06054b50){
+                end_record = i;
+                break;
+            }
+        }
+        if (end_record < 0){
+            std::cout << "Archive " << archive << " is not a zip archive\n";
+            continue;
+        }
+        int entries = zip_number(buffer, end_record + 10, 2);
+        std::string directory(zip_number(buffer, end_record + 12, 4), '\0');
+        in.seekg(zip_number(buffer, end_record + 16, 4));
+        in.read(&directory[0], directory.size());
+        
+        // (3) look for the member in the central directory
+        size_t p = 0;
+        for (int e = 0; e < entries && p + 46 <= directory.size() && zip_number(directory, p, 4) == 0x02014b50; e++){
+            int name_length = zip_number(directory, p + 28, 2);
+            std::string entry_name = directory.substr(p + 46, name_length);
+            if (entry_name.substr(entry_name.find_last_of('/') + 1) == name){
+                member.archive = archive;
+                member.name = entry_name;
+                member.method = zip_number(directory, p + 10, 2);
+                member.crc = zip_number(directory, p + 16, 4);
+                member.compressed_size = zip_number(directory, p + 20, 4);
+                member.uncompressed_size = zip_number(directory, p + 24, 4);
+                if ((member.method != 0 && member.method != 8) || member.compressed_size == 0xFFFFFFFF || member.uncompressed_size == 0xFFFFFFFF){
+                    std::cout << "Member " << entry_name << " of " << archive << " uses an unsupported compression or zip64\n";
+                    return false;
+                }
+                
+                // the data follows the local header (30 bytes, the name and an extra field of its own length)
+                std::string local(30, '\0');
+                in.seekg(zip_number(directory, p + 42, 4));
+                in.read(&local[0], local.size());
+                if (zip_number(local, 0, 4) != 0x04034b50){
+                    std::cout << "Archive " << archive << " is damaged\n";
+                    return false;
+                }
+                member.data_offset = zip_number(directory, p + 42, 4) + 30 + zip_number(local, 26, 2) + zip_number(local, 28, 2);
+                return true;
+            }
+            p += 46 + name_length + zip_number(directory, p + 30, 2) + zip_number(directory, p + 32, 2);
+        }
+        
+    }
+    return false;
+}
+
+
+// Task: Decompress a member from an access point and pass the output in pieces to emit (which returns false to stop).
+// If points is not null, access points are recorded along the way (starting at the beginning of the member).
+// Output: false if the archive cannot be read or is damaged
+bool inflate_member(
+                    const flux_archive_member & member,
+                    const flux_access_point & start,
+                    const std::function<bool(const char *, const size_t &)> & emit,
+                    std::vector<flux_access_point> * points )
+{
+    
+    // (1) open the archive
+    std::ifstream in(member.archive.c_str(), std::ios::binary);
+    if (in.fail()){
+        return false;
+    }
+    std::vector<unsigned char> input(1 << 16), output(1 << 16);
+    long long total_in = start.in;
+    long long total_out = start.out;
+    long long lines = start.lines;
+    long long last_point = start.out;
+    
+    // (2) stored members: every byte is an access point
+    if (member.method == 0){
+        in.seekg(member.data_offset + start.out);
+        while (total_out < member.uncompressed_size){
+            in.read((char *) output.data(), std::min((long long) output.size(), member.uncompressed_size - total_out));
+            size_t produced = in.gcount();
+            if (produced == 0){
+                return false;
+            }
+            lines += std::count(output.begin(), output.begin() + produced, '\n');
+            total_out += produced;
+            if (points && total_out - last_point >= flux_index_spacing){
+                points->push_back({total_out, total_out, 0, lines, ""});
+                last_point = total_out;
+            }
+            if (!emit((const char *) output.data(), produced)){
+                return true;
+            }
+        }
+        return true;
+    }
+    
+    // (3) deflated members: resume at the access point (the dictionary and a partial byte belong to it)
+    z_stream stream = {};
+    if (inflateInit2(&stream, -15) != Z_OK){
+        return false;
+    }
+    long long compressed_left = member.compressed_size - start.in + ((start.bits > 0) ? 1 : 0);
+    in.seekg(member.data_offset + start.in - ((start.bits > 0) ? 1 : 0));
+    if (start.bits > 0){
+        int byte = in.get();
+        compressed_left--;
+        inflatePrime(&stream, start.bits, byte >> (8 - start.bits));
+    }
+    if (start.window.size() > 0){
+        inflateSetDictionary(&stream, (const Bytef *) start.window.data(), start.window.size());
+    }
+    
+    // (4) inflate block by block
+    std::string window = start.window;
+    int status = Z_OK;
+    while (status != Z_STREAM_END){
+        
+        // refill the input
+        if (stream.avail_in == 0 && compressed_left > 0){
+            in.read((char *) input.data(), std::min((long long) input.size(), compressed_left));
+            stream.avail_in = in.gcount();
+            stream.next_in = input.data();
+            compressed_left -= stream.avail_in;
+            if (stream.avail_in == 0){
+                inflateEnd(&stream);
+                return false;
+            }
+        }
+        
+        // inflate up to the end of the current block (or until the output is full)
+        unsigned int available = stream.avail_in;
+        stream.next_out = output.data();
+        stream.avail_out = output.size();
+        status = inflate(&stream, Z_BLOCK);
+        if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR){
+            inflateEnd(&stream);
+            return false;
+        }
+        size_t produced = output.size() - stream.avail_out;
+        if (status == Z_BUF_ERROR && produced == 0 && compressed_left == 0){
+            // truncated data
+            inflateEnd(&stream);
+            return false;
+        }
+        total_in += available - stream.avail_in;
+        total_out += produced;
+        lines += std::count(output.begin(), output.begin() + produced, '\n');
+        
+        // access point at the end of a block (other than the last one)
+        if (points){
+            window.append((const char *) output.data(), produced);
+            if (window.size() > 2 * flux_window_size){
+                window.erase(0, window.size() - flux_window_size);
+            }
+            if ((stream.data_type & 128) && !(stream.data_type & 64) && total_out - last_point >= flux_index_spacing){
+                size_t length = std::min(window.size(), flux_window_size);
+                points->push_back({total_out, total_in, stream.data_type & 7, lines, window.substr(window.size() - length)});
+                last_point = total_out;
+            }
+        }
+        
+        // pass on the output
+        if (produced > 0 && !emit((const char *) output.data(), produced)){
+            break;
+        }
+        
+    }
+    inflateEnd(&stream);
+    return true;
+    
+}
+
+
+// Task: Load the index of a member, or build it (one pass over the member) and save it for later jobs.
+// Output: access points of the member (empty if the member cannot be read)
+std::vector<flux_access_point> flux_archive_index(const flux_archive_member & member)
+{
+    
+    // (1) the index lives next to the archive
+    std::string directory = member.archive.substr(0, member.archive.find_last_of('/') + 1);
+    std::string index_file = directory + member.name.substr(member.name.find_last_of('/') + 1) + ".index";
+    std::vector<flux_access_point> points;
+    
+    // (2) load it, if it belongs to this member
+    std::ifstream in(index_file.c_str(), std::ios::binary);
+    if (!in.fail()){
+        char magic[8];
+        uint32_t crc = 0;
+        long long compressed_size = 0, number = 0;
+        in.read(magic, 8);
+        in.read((char *) &crc, sizeof(crc));
+        in.read((char *) &compressed_size, sizeof(compressed_size));
+        in.read((char *) &number, sizeof(number));
+        if (in.good() && std::string(magic, 8) == "FLUXIDX1" && crc == member.crc && compressed_size == member.compressed_size){
+            points.resize(number);
+            for (flux_access_point & point : points){
+                long long window_size = 0;
+                in.read((char *) &point.out, sizeof(point.out));
+                in.read((char *) &point.in, sizeof(point.in));
+                in.read((char *) &point.bits, sizeof(point.bits));
+                in.read((char *) &point.lines, sizeof(point.lines));
+                in.read((char *) &window_size, sizeof(window_size));
+                point.window.assign(std::max(std::min(window_size, (long long) flux_window_size), 0LL), '\0');
+                in.read(&point.window[0], point.window.size());
+            }
+            if (in.good()){
+                return points;
+            }
+            points.clear();
+        }
+    }
+    
+    // (3) build it
+    if (!inflate_member(member, {0, 0, 0, 0, ""}, [](const char *, const size_t &){ return true; }, &points)){
+        return std::vector<flux_access_point>();
+    }
+    
+    // (4) save it (renamed into place, since several jobs may build it at the same time)
+    std::string temporary_file = index_file + ".tmp" + std::to_string(getpid());
+    std::ofstream ofile(temporary_file.c_str(), std::ios::binary);
+    long long compressed_size = member.compressed_size, number = points.size();
+    ofile.write("FLUXIDX1", 8);
+    ofile.write((const char *) &member.crc, sizeof(member.crc));
+    ofile.write((const char *) &compressed_size, sizeof(compressed_size));
+    ofile.write((const char *) &number, sizeof(number));
+    for (const flux_access_point & point : points){
+        long long window_size = point.window.size();
+        ofile.write((const char *) &point.out, sizeof(point.out));
+        ofile.write((const char *) &point.in, sizeof(point.in));
+        ofile.write((const char *) &point.bits, sizeof(point.bits));
+        ofile.write((const char *) &point.lines, sizeof(point.lines));
+        ofile.write((const char *) &window_size, sizeof(window_size));
+        ofile.write(point.window.data(), point.window.size());
+    }
+    ofile.close();
+    if (ofile.fail() || std::rename(temporary_file.c_str(), index_file.c_str()) != 0){
+        std::remove(temporary_file.c_str());
+    }
+    return points;
+    
+}
+
+
+// Lines of an archive member from a given line on, decompressed by a background thread
+class flux_archive_reader{
+
+public:
+    
+    flux_archive_reader(const flux_archive_member & member, const flux_access_point & start, const long long & skip) :
+        position(0), finished(false), stopped(false)
+    {
+        producer = boost::thread([this, member, start, skip](){ produce(member, start, skip); });
+    }
+    
+    ~flux_archive_reader()
+    {
+        {
+            std::lock_guard<std::mutex> lock(chunks_mutex);
+            stopped = true;
+        }
+        chunks_changed.notify_all();
+        producer.join();
+    }
+    
+    // Task: Read the next line (without the line end).
+    // Output: false at the end of the member
+    bool getline(std::string & line)
+    {
+        line.clear();
+        bool found = false;
+        while (true){
+            if (position < current.size()){
+                size_t end = current.find('\n', position);
+                if (end != std::string::npos){
+                    line.append(current, position, end - position);
+                    position = end + 1;
+                    return true;
+                }
+                line.append(current, position, std::string::npos);
+                position = current.size();
+                found = true;
+            }
+            std::unique_lock<std::mutex> lock(chunks_mutex);
+            chunks_changed.wait(lock, [this](){ return !chunks.empty() || finished; });
+            if (chunks.empty()){
+                return found;
+            }
+            current = std::move(chunks.front());
+            chunks.pop_front();
+            position = 0;
+            chunks_changed.notify_all();
+        }
+    }
+
+private:
+    
+    // Task: Decompress the member from the access point, drop the first skip lines and queue the rest in chunks.
+    void produce(const flux_archive_member & member, const flux_access_point & start, long long skip)
+    {
+        std::string pending;
+        std::function<bool(const char *, const size_t &)> emit = [this, &pending, &skip](const char * data, const size_t & size){
+            size_t offset = 0;
+            while (skip > 0 && offset < size){
+                const char * end = (const char *) std::memchr(data + offset, '\n', size - offset);
+                if (end == nullptr){
+                    return true;
+                }
+                offset = end - data + 1;
+                skip--;
+            }
+            pending.append(data + offset, size - offset);
+            if (pending.size() >= flux_chunk_size){
+                std::unique_lock<std::mutex> lock(chunks_mutex);
+                chunks_changed.wait(lock, [this](){ return chunks.size() < flux_chunks_ahead || stopped; });
+                if (stopped){
+                    return false;
+                }
+                chunks.push_back(std::move(pending));
+                pending.clear();
+                chunks_changed.notify_all();
+            }
+            return true;
+        };
+        if (!inflate_member(member, start, emit, nullptr)){
+            std::cout << "Member " << member.name << " of " << member.archive << " cannot be decompressed\n";
+        }
+        std::lock_guard<std::mutex> lock(chunks_mutex);
+        if (pending.size() > 0){
+            chunks.push_back(std::move(pending));
+        }
+        finished = true;
+        chunks_changed.notify_all();
+    }
+    
+    std::string current;
+    size_t position;
+    std::deque<std::string> chunks;
+    std::mutex chunks_mutex;
+    std::condition_variable chunks_changed;
+    bool finished;
+    bool stopped;
+    boost::thread producer;
+
+};
+
+
+// Task: Open the member "name" of the first archive which contains it, at line first_line (counted from 0).
+// Output: nullptr if no archive contains the member
+std::unique_ptr<flux_archive_reader> open_flux_archive(const std::vector<std::string> & archives, const std::string & name, const long long & first_line)
+{
+    
+    // (1) find the member
+    flux_archive_member member;
+    if (!find_archive_member(archives, name, member)){
+        return nullptr;
+    }
+    
+    // (2) start at the last access point before the line (the beginning of the member needs no index)
+    flux_access_point start = {0, 0, 0, 0, ""};
+    if (first_line > 0){
+        for (flux_access_point & point : flux_archive_index(member)){
+            if (point.lines < first_line){
+                start = std::move(point);
+            }
+        }
+    }
+    return std::unique_ptr<flux_archive_reader>(new flux_archive_reader(member, start, first_line - start.lines));
+    
+}
@@ -0,0 +1,147 @@
+// Batching of the fluxes of one diagram (see RootCountBatch in rootCounter.h).
+//
+// The reduced degrees of a batch are sorted, which arranges them in a trie along the vertex order (the elimination order
+// of the graph_plan). One depth-first walk through this trie enumerates the outfluxes of all h0 values of all fluxes: a
+// partial outflux of the first vertices is made once for all fluxes sharing these reduced degrees, and only the partial
+// outfluxes on the path of the walk are kept (as in enumerate_outfluxes). The weight assignments only depend on the
+// outflux, so every distinct outflux of a chunk of the walk is counted once and the genus factors are applied per flux.
+
+
+// Largest number of distinct outfluxes which are collected before they are counted
+const int batch_chunk_outfluxes = 1 << 16;
+
+
+// One outflux of one flux of the batch
+struct batch_entry{
+    int h0;                                         // h0 of the partition belonging to this outflux
+    int outflux;                                    // index in the list of distinct outfluxes of the chunk
+    boost::multiprecision::int128_t genus_factor;   // factor of the genus one vertices
+};
+
+
+// Consumer of the outfluxes of a batch (outflux, h0, genus factor, indices of the fluxes which have this outflux)
+typedef std::function<void(const std::vector<int> &, const int &, const boost::multiprecision::int128_t &, const std::vector<int> &)> batch_outflux_consumer;
+
+
+// Task: Enumerate the outfluxes with h0 in [h0_minima[i], h0_max] of every flux i of the batch.
+// Output: emit is called once per outflux of every leaf of the trie (an outflux can come from several leaves)
+void walk_batch_outfluxes(
+                                const std::vector<std::vector<int>> & degrees,
+                                const std::vector<int> & genera,
+                                const std::vector<int> & edge_numbers,
+                                const int & number_of_edges,
+                                const int & root,
+                                const std::vector<int> & h0_minima,
+                                const int & h0_max,
+                                const batch_outflux_consumer & emit )
+{
+    
+    // (1) sort the fluxes by their reduced degrees
+    int number_of_vertices = genera.size();
+    std::vector<int> order(degrees.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&degrees](const int & a, const int & b){ return degrees[a] < degrees[b]; });
+    
+    // (2) bounds on the flux sum of the vertices j, j+1, ... (to discard partial outfluxes early)
+    std::vector<int> min_rest(number_of_vertices + 1, 0), max_rest(number_of_vertices + 1, 0);
+    for (int j = number_of_vertices - 1; j >= 0; j--){
+        min_rest[j] = min_rest[j+1] + edge_numbers[j];
+        max_rest[j] = max_rest[j+1] + edge_numbers[j] * (root-1);
+    }
+    
+    // (3) walk through the trie depth-first: a snapshot holds one partial outflux of the vertices 0, ..., depth-1, which is
+    // shared by the fluxes order[first], ..., order[last-1] (they have the same reduced degrees at these vertices)
+    struct trie_data{
+        int depth;
+        int first;
+        int last;
+        std::vector<int> flux;
+        int h0;
+        int flux_sum;
+        boost::multiprecision::int128_t genus_factor;
+    };
+    std::stack<trie_data> snapshotStack;
+    trie_data currentSnapshot;
+    currentSnapshot.depth = 0;
+    currentSnapshot.first = 0;
+    currentSnapshot.last = degrees.size();
+    currentSnapshot.h0 = 0;
+    currentSnapshot.flux_sum = 0;
+    currentSnapshot.genus_factor = 1;
+    snapshotStack.push(currentSnapshot);
+    std::vector<int> fluxes;
+    std::vector<int> values;
+    while (!snapshotStack.empty()){
+        
+        // pick the top snapshot and delete it from the stack
+        currentSnapshot = snapshotStack.top();
+        snapshotStack.pop();
+        int j = currentSnapshot.depth;
+        
+        // complete outflux: shared by all fluxes of the snapshot with a small enough h0_min
+        if (j == number_of_vertices){
+            if (currentSnapshot.flux_sum != root * number_of_edges){
+                continue;
+            }
+            fluxes.clear();
+            for (int i = currentSnapshot.first; i < currentSnapshot.last; i++){
+                if (currentSnapshot.h0 >= h0_minima[order[i]]){
+                    fluxes.push_back(order[i]);
+                }
+            }
+            if (fluxes.size() > 0){
+                emit(currentSnapshot.flux, currentSnapshot.h0, currentSnapshot.genus_factor, fluxes);
+            }
+            continue;
+        }
+        
+        // children: the fluxes with equal reduced degree of vertex j, each with every value of the outflux of vertex j
+        // (same choices as compute_outfluxes)
+        for (int first = currentSnapshot.first; first < currentSnapshot.last; ){
+            int degree = degrees[order[first]][j];
+            int last = first;
+            while (last < currentSnapshot.last && degrees[order[last]][j] == degree){
+                last++;
+            }
+            for (int h = 0; currentSnapshot.h0 + h <= h0_max; h++){
+                values.clear();
+                if (h > 0){
+                    int f = degree - root * h + ((genera[j] == 0) ? root : 0);
+                    if ((edge_numbers[j] <= f) && (f <= edge_numbers[j] * (root-1))){
+                        values.push_back(f);
+                    }
+                }
+                else{
+                    int min_flux = std::max(degree + ((genera[j] == 0) ? 1 : 0), edge_numbers[j]);
+                    for (int f = min_flux; f <= edge_numbers[j] * (root-1); f++){
+                        if ((degree - f) % root == 0){
+                            values.push_back(f);
+                        }
+                    }
+                }
+                for (int f : values){
+                    int flux_sum = currentSnapshot.flux_sum + f;
+                    if (flux_sum + min_rest[j+1] > root * number_of_edges || flux_sum + max_rest[j+1] < root * number_of_edges){
+                        continue;
+                    }
+                    trie_data newSnapshot;
+                    newSnapshot.depth = j + 1;
+                    newSnapshot.first = first;
+                    newSnapshot.last = last;
+                    newSnapshot.flux = currentSnapshot.flux;
+                    newSnapshot.flux.push_back(f);
+                    newSnapshot.h0 = currentSnapshot.h0 + h;
+                    newSnapshot.flux_sum = flux_sum;
+                    newSnapshot.genus_factor = currentSnapshot.genus_factor;
+                    if (genera[j] == 1){
+                        newSnapshot.genus_factor *= (boost::multiprecision::int128_t) ((h == 0) ? root * root - 1 : root * root);
+                    }
+                    snapshotStack.push(newSnapshot);
+                }
+            }
+            first = last;
+        }
+        
+    }
+    
+}
@@ -0,0 +1,46 @@
+// Scheduling of the batches of a run by predicted cost (see RootCountBatch::predicted_costs). The batches are cut from
+// consecutive fluxes first, so the fluxes of a batch keep sharing the prefixes of their trie; only whole batches are moved.
+
+
+// Task: Order the batches longest-first and keep those of one shard. The batches are assigned to the shards by the
+// longest-processing-time rule (each batch goes to the shard with the least predicted work so far), which only depends
+// on the costs, so every job of a sharded run computes the same assignment.
+// Output: indices of the batches of the shard, heaviest first (in file order if order_by_cost is false)
+std::vector<int> schedule_batches(const std::vector<double> & costs, const bool & order_by_cost, const int & shards, const int & shard)
+{
+    
+    // (1) order by decreasing cost (ties by index)
+    std::vector<int> order(costs.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (order_by_cost){
+        std::stable_sort(order.begin(), order.end(), [&costs](const int & a, const int & b){ return costs[a] > costs[b]; });
+    }
+    
+    // (2) assign to the shards
+    std::vector<double> loads(std::max(shards, 1), 0);
+    std::vector<int> scheduled;
+    for (int i : order){
+        int target = std::min_element(loads.begin(), loads.end()) - loads.begin();
+        loads[target] += costs[i];
+        if (target == shard){
+            scheduled.push_back(i);
+        }
+    }
+    return scheduled;
+    
+}
+
+
+// Task: Append one line "predicted_states,visited_states,seconds,flux indices" per batch to the cost log,
+// to calibrate the cost model against the actual work (both count every outflux of the batch once).
+void log_cost(const std::string & cost_log, const std::vector<int> & indices, const double & predicted, const long long & states, const double & seconds)
+{
+    if (cost_log == ""){
+        return;
+    }
+    std::ofstream ofile(cost_log.c_str(), std::ios_base::app);
+    ofile << predicted << "," << states << "," << seconds << ",";
+    for (int j = 0; j < indices.size(); j++){
+        ofile << indices[j] << ((j < indices.size() - 1) ? " " : "\n");
+    }
+}
@@ -0,0 +1,135 @@
+// Level-synchronous counting: the states of all outfluxes are expanded one level of the graph_plan at a time, and the
+// states reached on the next level are aggregated by their residual flux (summing the multiplicities) before that level
+// is expanded in turn. So a residual flux which is reached in many ways is expanded once per level, not once per path.
+//
+// Every state carries a tag after its residual flux (e.g. the index of its outflux), which the levels never touch, so only
+// states with equal tags are merged. A level is aggregated in parallel: every package expands a part of the frontier into
+// a small local buffer, which is merged into shared tables (one per shard of the hash values, each with its own lock)
+// whenever it is full. If a level would exceed the memory budget, the count continues depth-first from the frontier of the
+// previous level.
+
+
+// States of one level: (residual flux followed by the tag, summed multiplicity)
+typedef std::vector<std::pair<std::vector<int>, boost::multiprecision::int128_t>> flux_frontier;
+
+
+// Default memory budget of the frontier (bytes)
+const size_t frontier_default_memory = (size_t) 1 << 30;
+
+
+// Number of new states which a package collects before it merges them into the shards
+const int frontier_buffer_states = 4096;
+
+
+// Task: Approximate memory of one aggregated state (key, multiplicity and node of the hash table).
+size_t frontier_state_bytes(const int & key_length)
+{
+    return sizeof(int) * key_length + sizeof(std::vector<int>) + sizeof(boost::multiprecision::int128_t) + 4 * sizeof(void *);
+}
+
+
+// Task: Frontier of the outfluxes on level 0, with the genus factors folded into the multiplicities.
+// Input: tagged = true tags every state with the index of its outflux, otherwise all states have tag 0 (and are merged).
+flux_frontier initial_frontier(
+                                const std::vector<int> & genera,
+                                const int root,
+                                const std::vector<std::vector<int>> & outfluxes,
+                                const std::vector<std::vector<int>> & partitions,
+                                const bool tagged )
+{
+    flux_frontier frontier;
+    for (int i = 0; i < outfluxes.size(); i++){
+        std::vector<int> key = outfluxes[i];
+        key.push_back(tagged ? i : 0);
+        frontier.push_back(std::make_pair(key, genus_factor(genera, root, partitions[i])));
+    }
+    return frontier;
+}
+
+
+// Worker for one level: expand the states with indices first, ..., last-1 of the frontier on level k and aggregate the
+// states on level k+1 into the shards (by hash value). The states are merged into the shards whenever the buffer is full
+// and at the end, and every merge adds the number of states it creates to new_states. Once new_states reaches state_limit,
+// exceeded is set and all workers stop buffering and merging (the shards are then incomplete), so the shards hold at
+// most state_limit plus one buffer (frontier_buffer_states) per worker.
+void expand_frontier_worker(
+                                const int root,
+                                const graph_plan & plan,
+                                const int k,
+                                const flux_frontier & frontier,
+                                const int first,
+                                const int last,
+                                std::vector<flux_table> & shards,
+                                std::vector<std::mutex> & shard_locks,
+                                const long long state_limit,
+                                std::atomic<long long> & new_states,
+                                std::atomic<bool> & exceeded,
+                                progress_counters * counters )
+{
+    long long states = 0;
+    flux_hash hash;
+    std::vector<flux_frontier> buffer(shards.size());
+    int buffered = 0;
+    std::function<void()> merge = [&](){
+        long long created = 0;
+        for (int s = 0; s < shards.size() && !exceeded.load(std::memory_order_relaxed); s++){
+            if (buffer[s].size() == 0){
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(shard_locks[s]);
+            size_t size = shards[s].size();
+            for (const std::pair<std::vector<int>, boost::multiprecision::int128_t> & state : buffer[s]){
+                shards[s][state.first] += state.second;
+            }
+            created += shards[s].size() - size;
+            buffer[s].clear();
+        }
+        buffered = 0;
+        if (new_states.fetch_add(created, std::memory_order_relaxed) + created >= state_limit){
+            exceeded = true;
+        }
+    };
+    for (int i = first; i < last && !exceeded.load(std::memory_order_relaxed); i++){
+        enumerate_levels(root, plan, frontier[i].first, frontier[i].second, k, k + 1,
+                         [&](const std::vector<int> & flux, const boost::multiprecision::int128_t & mult){
+                             if (exceeded.load(std::memory_order_relaxed)){
+                                 return;
+                             }
+                             buffer[hash(flux) % shards.size()].push_back(std::make_pair(flux, mult));
+                             if (++buffered == frontier_buffer_states){
+                                 merge();
+                             }
+                         },
+                         states, counters);
+    }
+    merge();
+    if (counters != nullptr){
+        counters->states.fetch_add(states % 4096, std::memory_order_relaxed);
+    }
+}
+
+
+// Worker for the end of the count: sum of the multiplicities of the states on the last level reached depth-first from each
+// state with index first, ..., last-1 of the frontier on level k (counts[i]); on level 0 these states are the outfluxes
+void finish_frontier_worker(
+                                const int root,
+                                const graph_plan & plan,
+                                const int k,
+                                const flux_frontier & frontier,
+                                const int first,
+                                const int last,
+                                std::vector<boost::multiprecision::int128_t> & counts,
+                                progress_counters * counters )
+{
+    long long states = 0;
+    for (int i = first; i < last; i++){
+        boost::multiprecision::int128_t & count = counts[i];
+        enumerate_levels(root, plan, frontier[i].first, frontier[i].second, k, plan.number_of_levels(),
+                         [&count](const std::vector<int> &, const boost::multiprecision::int128_t & mult){ count += mult; },
+                         states, counters);
+    }
+    if (counters != nullptr){
+        counters->states.fetch_add(states % 4096, std::memory_order_relaxed);
+        counters->outfluxes.fetch_add((k == 0) ? last - first : 0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,141 @@
+// Hardware topology: usable CPUs, cgroup CPU quota and NUMA nodes (Linux, with fallbacks for other systems)
+
+
+// Task: Parse a CPU (or node) list of the form "0-3,8,10-11".
+std::vector<int> parse_cpu_list(const std::string & list)
+{
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')){
+        size_t pos = range.find("-");
+        if (range.find_first_of("0123456789") == std::string::npos){
+            continue;
+        }
+        int first = std::atoi(range.substr(0, pos).c_str());
+        int last = (pos == std::string::npos) ? first : std::atoi(range.substr(pos + 1).c_str());
+        for (int cpu = first; cpu <= last; cpu++){
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+
+// Task: CPUs on which this process may run.
+std::vector<int> allowed_cpus()
+{
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0){
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++){
+            if (CPU_ISSET(cpu, &mask)){
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    if (cpus.size() == 0){
+        for (int cpu = 0; cpu < std::max(1, (int) boost::thread::hardware_concurrency()); cpu++){
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+
+// Task: Number of CPUs granted by the cgroup CPU quota (cgroup v2 or v1).
+// Output: -1 if there is no quota
+int cgroup_cpu_limit()
+{
+    
+    // cgroup v2: "<quota> <period>" or "max <period>"
+    std::ifstream v2("/sys/fs/cgroup/cpu.max");
+    if (v2.good()){
+        std::string quota;
+        double period = 0;
+        v2 >> quota >> period;
+        if (quota != "max" && period > 0){
+            return std::max(1, (int) std::ceil(std::atof(quota.c_str()) / period));
+        }
+        return -1;
+    }
+    
+    // cgroup v1: quota is -1 if not limited
+    std::ifstream quota_file("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+    std::ifstream period_file("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+    double quota = -1;
+    double period = 0;
+    if (quota_file.good() && period_file.good()){
+        quota_file >> quota;
+        period_file >> period;
+    }
+    if (quota > 0 && period > 0){
+        return std::max(1, (int) std::ceil(quota / period));
+    }
+    return -1;
+    
+}
+
+
+// Task: Number of threads to use: the environment variable ROOTCOUNTER_THREADS if set, otherwise the number of CPUs
+// this process may run on, limited by the cgroup CPU quota.
+int detect_thread_number()
+{
+    const char * environment = std::getenv("ROOTCOUNTER_THREADS");
+    if (environment != nullptr && std::atoi(environment) > 0){
+        return std::atoi(environment);
+    }
+    int threads = allowed_cpus().size();
+    int limit = cgroup_cpu_limit();
+    if (limit > 0){
+        threads = std::min(threads, limit);
+    }
+    return std::max(threads, 1);
+}
+
+
+// Task: Group the allowed CPUs by NUMA node (nodes without allowed CPUs are dropped).
+// Output: one node with all allowed CPUs if the topology is unknown
+std::vector<std::vector<int>> numa_node_cpus()
+{
+    std::vector<int> cpus = allowed_cpus();
+    std::vector<std::vector<int>> nodes;
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string node_list;
+    std::getline(online, node_list);
+    for (int node : parse_cpu_list(node_list)){
+        std::ifstream in(("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist").c_str());
+        std::string list;
+        std::getline(in, list);
+        std::vector<int> node_cpus;
+        for (int cpu : parse_cpu_list(list)){
+            if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end()){
+                node_cpus.push_back(cpu);
+            }
+        }
+        if (node_cpus.size() > 0){
+            nodes.push_back(node_cpus);
+        }
+    }
+    if (nodes.size() == 0){
+        nodes.push_back(cpus);
+    }
+    return nodes;
+}
+
+
+// Task: Restrict the given thread to the given CPUs.
+void set_thread_affinity(boost::thread::native_handle_type thread, const std::vector<int> & cpus)
+{
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int cpu : cpus){
+        CPU_SET(cpu, &mask);
+    }
+    pthread_setaffinity_np(thread, sizeof(mask), &mask);
+#endif
+}
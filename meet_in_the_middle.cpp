@@ -0,0 +1,352 @@
+// Meet-in-the-middle counting: the levels of the graph_plan are split at a level s into a prefix [0, s) and a suffix [s, L).
+//
+// The states reached after the prefix are only distinguished by their residual flux. So the prefix states of all outfluxes
+// are aggregated into a table residual flux -> summed multiplicity (the genus factor of the outflux is folded in), the
+// suffix is counted once per distinct residual flux and the two are joined by key:
+//     total = sum over residual fluxes of prefix multiplicity * suffix count.
+// The split s is chosen from estimated numbers of states per level (Knuth estimates) and bounds on the number of keys.
+
+
+// Hash of a residual flux
+struct flux_hash{
+    size_t operator()(const std::vector<int> & flux) const{
+        uint64_t h = 14695981039346656037ULL;
+        for (int j = 0; j < flux.size(); j++){
+            h = (h ^ (uint64_t) (uint32_t) flux[j]) * 1099511628211ULL;
+        }
+        return (size_t) (h ^ (h >> 29));
+    }
+};
+typedef std::unordered_map<std::vector<int>, boost::multiprecision::int128_t, flux_hash> flux_table;
+
+
+// Task: Enumerate the weight assignments of the levels [first_level, last_level) starting from the given flux.
+// Output: leaf(flux, mult) is called for every state reached at last_level, states is increased by the number of visited states.
+template <typename Leaf>
+void enumerate_levels(
+                                const int root,
+                                const graph_plan & plan,
+                                const std::vector<int> & start_flux,
+                                const boost::multiprecision::int128_t & start_mult,
+                                const int first_level,
+                                const int last_level,
+                                Leaf leaf,
+                                long long & states,
+                                progress_counters * counters )
+{
+    
+    struct comb_data{
+        std::vector<int> flux;
+        int k;
+        boost::multiprecision::int128_t mult;
+    };
+    std::vector<int> minima, maxima;
+    std::vector<std::vector<int>> flux_partitions;
+    
+    // create stack and add first snapshot
+    std::stack<comb_data> snapshotStack;
+    comb_data currentSnapshot;
+    currentSnapshot.flux = start_flux;
+    currentSnapshot.k = first_level;
+    currentSnapshot.mult = start_mult;
+    snapshotStack.push(currentSnapshot);
+    
+    // Run...
+    while(!snapshotStack.empty())
+    {
+        
+        // pick the top snapshot and delete it from the stack
+        currentSnapshot = snapshotStack.top();
+        snapshotStack.pop();
+        
+        // report progress from time to time (relaxed atomic add to the own counters, no locks)
+        if (++states % 4096 == 0 && counters != nullptr){
+            counters->states.fetch_add(4096, std::memory_order_relaxed);
+        }
+        
+        // state at the last level
+        if (currentSnapshot.k == last_level){
+            leaf(currentSnapshot.flux, currentSnapshot.mult);
+            continue;
+        }
+        
+        // create new snapshots for all flux_partitions (levels which assign nothing are passed)
+        if (!level_partitions(root, plan, currentSnapshot.k, currentSnapshot.flux, minima, maxima, flux_partitions)){
+            currentSnapshot.k++;
+            snapshotStack.push(currentSnapshot);
+            continue;
+        }
+        const stratification_step * steps = plan.level(currentSnapshot.k);
+        int n = plan.level_size(currentSnapshot.k);
+        for (int j = 0; j < flux_partitions.size(); j++){
+            comb_data newSnapshot;
+            newSnapshot.flux = currentSnapshot.flux;
+            apply_level_partition(root, plan, currentSnapshot.k, flux_partitions[j], newSnapshot.flux);
+            newSnapshot.mult = currentSnapshot.mult;
+            for (int a = 0; a < n; a++){
+                newSnapshot.mult *= number_partitions(flux_partitions[j][a], steps[a].connecting_edges, root);
+            }
+            newSnapshot.k = currentSnapshot.k + 1;
+            snapshotStack.push(newSnapshot);
+        }
+        
+    }
+    
+}
+
+
+// Worker for the prefix: aggregate the states at level split of the outfluxes with indices first, ..., last-1
+void prefix_worker(
+                                const std::vector<int> & genera,
+                                const int root,
+                                const graph_plan & plan,
+                                const int split,
+                                const std::vector<std::vector<int>> & outfluxes,
+                                const std::vector<std::vector<int>> & partitions,
+                                const int first,
+                                const int last,
+                                flux_table & table,
+                                progress_counters * counters )
+{
+    long long states = 0;
+    for (int i = first; i < last; i++){
+        
+        // aggregate the states at level split (with the genus factor of this outflux)
+        enumerate_levels(root, plan, outfluxes[i], genus_factor(genera, root, partitions[i]), 0, split,
+                         [&table](const std::vector<int> & flux, const boost::multiprecision::int128_t & mult){ table[flux] += mult; },
+                         states, counters);
+        if (counters != nullptr){
+            counters->outfluxes.fetch_add(1, std::memory_order_relaxed);
+        }
+        
+    }
+    if (counters != nullptr){
+        counters->states.fetch_add(states % 4096, std::memory_order_relaxed);
+    }
+}
+
+
+// Worker for the suffix: sum of prefix multiplicity * suffix count over the keys with indices first, ..., last-1
+void suffix_worker(
+                                const int root,
+                                const graph_plan & plan,
+                                const int split,
+                                const std::vector<std::pair<std::vector<int>, boost::multiprecision::int128_t>> & keys,
+                                const int first,
+                                const int last,
+                                boost::multiprecision::int128_t & sum,
+                                progress_counters * counters )
+{
+    boost::multiprecision::int128_t total = 0;
+    long long states = 0;
+    for (int i = first; i < last; i++){
+        boost::multiprecision::int128_t suffix_count = 0;
+        enumerate_levels(root, plan, keys[i].first, 1, split, plan.number_of_levels(),
+                         [&suffix_count](const std::vector<int> &, const boost::multiprecision::int128_t & mult){ suffix_count += mult; },
+                         states, counters);
+        total += keys[i].second * suffix_count;
+    }
+    if (counters != nullptr){
+        counters->states.fetch_add(states % 4096, std::memory_order_relaxed);
+    }
+    sum = total;
+}
+
+
+// Worker for the suffix counts of the keys with indices first, ..., last-1 (for joins with several prefixes)
+void suffix_count_worker(
+                                const int root,
+                                const graph_plan & plan,
+                                const int split,
+                                const std::vector<std::vector<int>> & keys,
+                                const int first,
+                                const int last,
+                                flux_table & suffix_counts,
+                                progress_counters * counters )
+{
+    long long states = 0;
+    for (int i = first; i < last; i++){
+        boost::multiprecision::int128_t & suffix_count = suffix_counts.at(keys[i]);
+        enumerate_levels(root, plan, keys[i], 1, split, plan.number_of_levels(),
+                         [&suffix_count](const std::vector<int> &, const boost::multiprecision::int128_t & mult){ suffix_count += mult; },
+                         states, counters);
+    }
+    if (counters != nullptr){
+        counters->states.fetch_add(states % 4096, std::memory_order_relaxed);
+    }
+}
+
+
+// Worker for the join of every single outflux with indices first, ..., last-1 with the suffix counts (without genus factors)
+void join_worker(
+                                const int root,
+                                const graph_plan & plan,
+                                const int split,
+                                const std::vector<std::vector<int>> & outfluxes,
+                                const int first,
+                                const int last,
+                                const flux_table & suffix_counts,
+                                std::vector<boost::multiprecision::int128_t> & weights,
+                                progress_counters * counters )
+{
+    long long states = 0;
+    for (int i = first; i < last; i++){
+        boost::multiprecision::int128_t weight = 0;
+        enumerate_levels(root, plan, outfluxes[i], 1, 0, split,
+                         [&weight, &suffix_counts](const std::vector<int> & flux, const boost::multiprecision::int128_t & mult){ weight += mult * suffix_counts.at(flux); },
+                         states, counters);
+        weights[i] = weight;
+    }
+    if (counters != nullptr){
+        counters->states.fetch_add(states % 4096, std::memory_order_relaxed);
+    }
+}
+
+
+// Task: Draw a random flux partition of level k within the bounds of level_bounds: every entry is picked uniformly among
+// the values which leave a feasible rest, so a draw costs O(level size) however many flux partitions there are.
+// Output: product of the numbers of values (the Knuth estimate of the number of flux partitions), 0 if there is none
+double draw_level_partition(
+                                const int N,
+                                const std::vector<int> & minima,
+                                const std::vector<int> & maxima,
+                                std::mt19937_64 & generator,
+                                std::vector<int> & flux_partition )
+{
+    int n = minima.size();
+    std::vector<int> min_rest(n + 1, 0), max_rest(n + 1, 0);
+    for (int a = n - 1; a >= 0; a--){
+        min_rest[a] = min_rest[a+1] + minima[a];
+        max_rest[a] = max_rest[a+1] + maxima[a];
+    }
+    if (N < min_rest[0] || N > max_rest[0]){
+        return 0;
+    }
+    flux_partition.clear();
+    double weight = 1;
+    int left = N;
+    for (int a = 0; a < n; a++){
+        int low = std::max(minima[a], left - max_rest[a+1]);
+        int high = std::min(maxima[a], left - min_rest[a+1]);
+        int value = std::uniform_int_distribution<int>(low, high)(generator);
+        weight *= high - low + 1;
+        flux_partition.push_back(value);
+        left -= value;
+    }
+    return weight;
+}
+
+
+// Task: Descend from the outflux through all levels with random flux partitions (Knuth) and add the product of the
+// estimated branching numbers, times the weight of the outflux, to the states of every level.
+void descend_levels(
+                                const int root,
+                                const graph_plan & plan,
+                                std::vector<int> flux,
+                                double weight,
+                                std::mt19937_64 & generator,
+                                std::vector<double> & level_states )
+{
+    std::vector<int> minima, maxima, flux_partition;
+    level_states[0] += weight;
+    for (int k = 0; k < plan.number_of_levels(); k++){
+        if (level_bounds(root, plan, k, flux, minima, maxima)){
+            weight *= draw_level_partition(flux[k], minima, maxima, generator, flux_partition);
+            if (weight == 0){
+                break;
+            }
+            apply_level_partition(root, plan, k, flux_partition, flux);
+        }
+        level_states[k + 1] += weight;
+    }
+}
+
+
+// Task: Estimate the number of DFS states on every level by random descents from uniformly chosen outfluxes.
+// Output: level_states[k] = estimated number of states at level k (k = 0, ..., number_of_levels)
+std::vector<double> estimate_level_states(
+                                const int root,
+                                const graph_plan & plan,
+                                const std::vector<std::vector<int>> & outfluxes,
+                                const int samples,
+                                const uint64_t seed )
+{
+    
+    int L = plan.number_of_levels();
+    std::vector<double> level_states(L + 1, 0);
+    std::mt19937_64 generator(seed);
+    std::uniform_int_distribution<int> pick_outflux(0, (int) outfluxes.size() - 1);
+    for (int s = 0; s < samples; s++){
+        descend_levels(root, plan, outfluxes[pick_outflux(generator)], (double) outfluxes.size(), generator, level_states);
+    }
+    for (int k = 0; k <= L; k++){
+        level_states[k] /= samples;
+    }
+    return level_states;
+    
+}
+
+
+// Task: Choose the split level of the meet-in-the-middle engine.
+// Cost of split s: states of the prefix + (number of keys) * (average number of suffix states per state at level s),
+// where the number of keys at level s is bounded by the estimated number of states and by the product of the number
+// of values which the residual flux of every vertex >= s can take.
+// Output: split level in [0, number_of_levels] (0 and number_of_levels amount to the plain DFS)
+int choose_split(
+                                const int root,
+                                const graph_plan & plan,
+                                const std::vector<std::vector<int>> & outfluxes )
+{
+    
+    // (1) estimated number of states per level
+    int L = plan.number_of_levels();
+    std::vector<double> level_states = estimate_level_states(root, plan, outfluxes, 1024, 2718281828ULL);
+    
+    // (2) number of distinct outflux values of every vertex
+    int number_of_vertices = outfluxes[0].size();
+    std::vector<double> outflux_values(number_of_vertices, 1);
+    for (int v = 0; v < number_of_vertices; v++){
+        std::vector<int> values;
+        for (int i = 0; i < outfluxes.size(); i++){
+            values.push_back(outfluxes[i][v]);
+        }
+        std::sort(values.begin(), values.end());
+        outflux_values[v] = std::unique(values.begin(), values.end()) - values.begin();
+    }
+    
+    // (3) compare the costs of all splits
+    std::vector<int> remaining_edges(number_of_vertices, -1);
+    int best_split = 0;
+    double best_cost = -1;
+    double prefix_states = 0;
+    for (int s = 0; s <= L; s++){
+        
+        // bound on the number of keys: residual fluxes of vertices touched by the prefix lie in [e, e * (root-1)]
+        // for the e remaining edges, the other vertices still carry their outflux
+        double key_bound = 1;
+        for (int v = s; v < number_of_vertices; v++){
+            key_bound *= (remaining_edges[v] < 0) ? outflux_values[v] : remaining_edges[v] * (root-2) + 1;
+        }
+        prefix_states += level_states[s];
+        double suffix_states = 0;
+        for (int k = s; k <= L; k++){
+            suffix_states += level_states[k];
+        }
+        double keys = std::min(level_states[s], key_bound);
+        double cost = prefix_states + ((level_states[s] > 0) ? keys * suffix_states / level_states[s] : 0);
+        if (best_cost < 0 || cost < best_cost){
+            best_cost = cost;
+            best_split = s;
+        }
+        
+        // vertices touched by level s
+        if (s < L){
+            for (int j = 0; j < plan.level_size(s); j++){
+                remaining_edges[plan.level(s)[j].vertex] = plan.level(s)[j].remaining_edges;
+            }
+        }
+        
+    }
+    return best_split;
+    
+}
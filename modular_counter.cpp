@@ -0,0 +1,303 @@
+// Multi-modular root counting: the count is run modulo several 62-bit primes with native
+// multiply-mod and the exact result is reconstructed by the Chinese remainder theorem.
+
+
+// Task: Multiply two residues modulo a prime below 2^62.
+inline uint64_t mul_mod(const uint64_t & a, const uint64_t & b, const uint64_t & p)
+{
+    return (uint64_t) (((unsigned __int128) a * b) % p);
+}
+
+
+// Task: Compute a^e modulo a prime below 2^62.
+uint64_t pow_mod(uint64_t a, uint64_t e, const uint64_t & p)
+{
+    uint64_t result = 1 % p;
+    a = a % p;
+    while (e > 0){
+        if (e & 1){
+            result = mul_mod(result, a, p);
+        }
+        a = mul_mod(a, a, p);
+        e >>= 1;
+    }
+    return result;
+}
+
+
+// Task: Deterministic Miller-Rabin test for 64-bit integers.
+bool is_prime_64(const uint64_t & n)
+{
+    if (n < 2){
+        return false;
+    }
+    const uint64_t bases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+    for (uint64_t b : bases){
+        if (n % b == 0){
+            return n == b;
+        }
+    }
+    uint64_t d = n - 1;
+    int s = 0;
+    while ((d & 1) == 0){
+        d >>= 1;
+        s++;
+    }
+    for (uint64_t b : bases){
+        uint64_t x = pow_mod(b, d, n);
+        if (x == 1 || x == n - 1){
+            continue;
+        }
+        bool composite = true;
+        for (int i = 1; i < s; i++){
+            x = mul_mod(x, x, n);
+            if (x == n - 1){
+                composite = false;
+                break;
+            }
+        }
+        if (composite){
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Task: Return the first number_of_primes primes below 2^62 (in decreasing order).
+std::vector<uint64_t> crt_primes(const int & number_of_primes)
+{
+    std::vector<uint64_t> primes;
+    uint64_t candidate = (((uint64_t) 1) << 62) - 1;
+    while (primes.size() < number_of_primes){
+        if (is_prime_64(candidate)){
+            primes.push_back(candidate);
+        }
+        candidate -= 2;
+    }
+    return primes;
+}
+
+
+// Task: Upper bound for the number of roots with any h0.
+// Every weight assignment is counted at most once (it determines the outflux and thus the h0 partition) and
+// there are at most (root-1)^(#edges) of them. Each genus one vertex contributes a factor of at most root^2.
+boost::multiprecision::cpp_int root_count_bound(
+        const std::vector<int> & genera,
+        const std::vector<std::vector<int>> & edges,
+        const int & root)
+{
+    boost::multiprecision::cpp_int bound = 1;
+    for (int i = 0; i < edges.size(); i++){
+        bound *= (root - 1);
+    }
+    for (int j = 0; j < genera.size(); j++){
+        if (genera[j] == 1){
+            bound *= root * root;
+        }
+    }
+    return bound;
+}
+
+
+// Task: Number of primes below 2^62 needed for their product to exceed the bound.
+int crt_number_of_primes(const boost::multiprecision::cpp_int & bound)
+{
+    int number_of_primes = 0;
+    boost::multiprecision::cpp_int modulus = 1;
+    while (modulus <= bound){
+        modulus <<= 61;
+        number_of_primes++;
+    }
+    return number_of_primes;
+}
+
+
+// Task: Reconstruct the integer 0 <= x < product of the primes from its residues (Garner's algorithm).
+// Arbitrary precision is only needed if there is more than one prime.
+boost::multiprecision::cpp_int crt_reconstruct(const std::vector<uint64_t> & residues, const std::vector<uint64_t> & primes)
+{
+    boost::multiprecision::cpp_int result = residues[0];
+    if (primes.size() > 1){
+        boost::multiprecision::cpp_int product = primes[0];
+        for (int q = 1; q < primes.size(); q++){
+            uint64_t p = primes[q];
+            uint64_t current = (uint64_t) (result % p);
+            uint64_t inverse = pow_mod((uint64_t) (product % p), p - 2, p);
+            uint64_t coefficient = mul_mod((residues[q] + p - current) % p, inverse, p);
+            result += product * coefficient;
+            product *= p;
+        }
+    }
+    return result;
+}
+
+
+// Task: Tabulate number_partitions(f, n, root) modulo p for 0 <= n <= max_n and 0 <= f <= max_n * (root-1).
+// Output: table[n][f]
+std::vector<std::vector<uint64_t>> number_partitions_table_mod(
+        const int & max_n,
+        const int & root,
+        const uint64_t & p)
+{
+    int max_f = max_n * (root - 1);
+    std::vector<std::vector<uint64_t>> table(max_n + 1, std::vector<uint64_t>(max_f + 1, 0));
+    table[0][0] = 1 % p;
+    for (int n = 1; n <= max_n; n++){
+        for (int f = n; f <= n * (root - 1); f++){
+            uint64_t count = 0;
+            for (int i = 1; i < root && i <= f; i++){
+                count += table[n-1][f-i];
+                if (count >= p){
+                    count -= p;
+                }
+            }
+            table[n][f] = count;
+        }
+    }
+    return table;
+}
+
+
+// Count the weight assignments of one outflux modulo p, times the genus factor of its h0 partition
+// (compiled for several instruction sets in counting_kernels.cpp, see cpu_dispatch.cpp)
+uint64_t modular_count_outflux(
+                                const std::vector<int> & genera,
+                                const int root,
+                                const graph_plan & plan,
+                                const std::vector<int> & outflux,
+                                const std::vector<int> & partition,
+                                const uint64_t p,
+                                const std::vector<std::vector<uint64_t>> & partition_table,
+                                progress_counters * counters );
+
+
+// Worker thread for the parallel modular run
+void modular_worker(
+                                const std::vector<int> & genera,
+                                const int root,
+                                const graph_plan & plan,
+                                const std::vector<std::vector<int>> & outfluxes,
+                                const std::vector<std::vector<int>> & partitions,
+                                const int first,
+                                const int last,
+                                const uint64_t p,
+                                const std::vector<std::vector<uint64_t>> & partition_table,
+                                uint64_t & sum,
+                                progress_counters * counters )
+{
+    
+    uint64_t total = 0;
+    for (int i = first; i < last; i++){
+        total += modular_count_outflux(genera, root, plan, outfluxes[i], partitions[i], p, partition_table, counters);
+        if (total >= p){
+            total -= p;
+        }
+    }
+    
+    // Save result (every package has its own slot, so no lock is needed)
+    sum = total;
+    
+}
+
+
+
+// Count number of root bundles with prescribed number of sections by multi-modular arithmetic
+boost::multiprecision::cpp_int modular_root_counter(
+                                const int genus,
+                                const std::vector<int> & degrees,
+                                const std::vector<int> & genera,
+                                const std::vector<std::vector<int>> & edges,
+                                const int root,
+                                const std::vector<std::vector<std::vector<int>>> & graph_stratification,
+                                const std::vector<int> & edge_numbers,
+                                const int & h0_value,
+                                const int & thread_number,
+                                const bool & display_details )
+{
+    
+    // check input
+    if (thread_number <= 0){
+        std::cout << "Corrupted input\n";
+        return -1;
+    }
+    
+    // check for degenerate case: h0_min > h0_value
+    int total_degree = std::accumulate(degrees.begin(), degrees.end(), 0);
+    if ((int)(total_degree/root) - genus + 1 > h0_value){
+        return 0;
+    }
+    
+    // (1) Partition h0
+    // (1) Partition h0
+    std::vector<std::vector<int>> partitions;
+    comp_partitions(h0_value, degrees.size(), std::vector<int>(degrees.size(),0), std::vector<int>(degrees.size(),h0_value), partitions);
+    
+    
+    // (2) Find fluxes corresponding to partitions
+    // (2) Find fluxes corresponding to partitions
+    std::vector<std::vector<int>> outfluxes;
+    std::vector<std::vector<int>> h0_partitions;
+    compute_outfluxes(degrees, genera, edges, root, edge_numbers, partitions, outfluxes, h0_partitions);
+    
+    
+    // (3) Pick as many primes as needed for the product of the primes to exceed the bound
+    // (3) Pick as many primes as needed for the product of the primes to exceed the bound
+    int number_of_primes = crt_number_of_primes(root_count_bound(genera, edges, root));
+    std::vector<uint64_t> primes = crt_primes(number_of_primes);
+    graph_plan plan = compile_graph_plan(graph_stratification);
+    
+    
+    // (4) Run one pass per prime, each split into packages of outfluxes, all in parallel
+    // (4) Run one pass per prime, each split into packages of outfluxes, all in parallel
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    int packages = std::max(1, thread_number / number_of_primes);
+    int package_size = (int) outfluxes.size()/packages;
+    std::vector<std::vector<std::vector<uint64_t>>> partition_tables(number_of_primes);
+    for (int q = 0; q < number_of_primes; q++){
+        partition_tables[q] = number_partitions_table_mod(plan.max_connecting_edges, root, primes[q]);
+    }
+    std::vector<uint64_t> package_sums(number_of_primes * packages, 0);
+    if (display_details){
+        std::cout << "Computing modulo " << number_of_primes << " primes in " << number_of_primes * packages << " parallel threads (average load: " << package_size << ")...\n";
+    }
+    if (number_of_primes * packages > 1){
+        boost::thread_group threadList;
+        for (int q = 0; q < number_of_primes; q++){
+            for (int i = 0; i < packages; i++){
+                int first = i * package_size;
+                int last = (i < packages - 1) ? (i+1) * package_size : (int) outfluxes.size();
+                boost::thread *t = new boost::thread([&, q, i, first, last](){
+                    modular_worker(genera, root, plan, outfluxes, h0_partitions, first, last, primes[q], partition_tables[q], package_sums[q * packages + i], nullptr);
+                });
+                threadList.add_thread(t);
+            }
+        }
+        threadList.join_all();
+    }
+    else{
+        modular_worker(genera, root, plan, outfluxes, h0_partitions, 0, (int) outfluxes.size(), primes[0], partition_tables[0], package_sums[0], nullptr);
+    }
+    std::vector<uint64_t> residues(number_of_primes, 0);
+    for (int q = 0; q < number_of_primes; q++){
+        for (int i = 0; i < packages; i++){
+            residues[q] = (residues[q] + package_sums[q * packages + i]) % primes[q];
+        }
+    }
+    std::chrono::steady_clock::time_point later = std::chrono::steady_clock::now();
+    
+    
+    // (5) Reconstruct the result by the Chinese remainder theorem (only grow to arbitrary precision if needed)
+    // (5) Reconstruct the result by the Chinese remainder theorem (only grow to arbitrary precision if needed)
+    boost::multiprecision::cpp_int sum = crt_reconstruct(residues, primes);
+    
+    
+    // (6) inform about the result
+    // (6) inform about the result
+    if (display_details){
+        std::cout << "\nTime for run: " << std::chrono::duration_cast<std::chrono::seconds>(later - now).count() << "[s]\n";
+        std::cout << "Total: " << sum << "\n\n";
+    }
+    return sum;
+    
+}
@@ -0,0 +1,253 @@
+// Monte Carlo estimation of root counts by importance-sampled random descents through the DFS tree of worker.
+//
+// A descent starts at an outflux drawn by a random descent through the choices of enumerate_outfluxes (so the outfluxes
+// are never enumerated and the time budget holds for any number of outfluxes): every vertex picks its h and outflux
+// uniformly among the options which can still reach the flux sum, and the weight is multiplied by the number of options
+// (Knuth). On level k, it picks one of the flux_partitions with probability
+// proportional to its multiplicity (product of the number_partitions) and multiplies its weight by the sum of all
+// multiplicities of this level. At the leaf, the weight is multiplied by the genus factor.
+// The expected weight is the exact count, so the mean of the weights is an unbiased estimate.
+
+
+// Running mean and variance of samples (Welford), which can be merged across threads (Chan et al.)
+struct sample_statistics{
+    
+    long long samples = 0;
+    double mean = 0;
+    double m2 = 0;
+    
+    void add(const double & x){
+        samples++;
+        double delta = x - mean;
+        mean += delta / samples;
+        m2 += delta * (x - mean);
+    }
+    
+    void merge(const sample_statistics & other){
+        if (other.samples == 0){
+            return;
+        }
+        long long n = samples + other.samples;
+        double delta = other.mean - mean;
+        mean += delta * other.samples / n;
+        m2 += other.m2 + delta * delta * ((double) samples * other.samples / n);
+        samples = n;
+    }
+
+};
+
+
+// Random outfluxes for one h0 value (same choices as enumerate_outfluxes)
+struct outflux_sampler{
+    
+    outflux_sampler(const std::vector<int> & degrees, const std::vector<int> & genera, const std::vector<int> & edge_numbers,
+                    const int & number_of_edges, const int & root, const int & h0_value) :
+        degrees(degrees), genera(genera), edge_numbers(edge_numbers), root(root), h0_value(h0_value),
+        flux_sum(root * number_of_edges), min_rest(degrees.size() + 1, 0), max_rest(degrees.size() + 1, 0)
+    {
+        for (int j = (int) degrees.size() - 1; j >= 0; j--){
+            min_rest[j] = min_rest[j+1] + edge_numbers[j];
+            max_rest[j] = max_rest[j+1] + edge_numbers[j] * (root-1);
+        }
+    }
+    
+    // Task: Draw an outflux and its h0 partition.
+    // Output: product of the numbers of options (0 if the descent runs into a dead end)
+    double draw(std::mt19937_64 & generator, std::vector<int> & flux, std::vector<int> & partition) const{
+        flux.clear();
+        partition.clear();
+        double weight = 1;
+        int sum = 0;
+        int h0_left = h0_value;
+        std::vector<std::pair<int, int>> options;
+        for (int j = 0; j < degrees.size(); j++){
+            
+            // options (h, f) of vertex j (the last vertex takes the h0 which is left)
+            options.clear();
+            for (int h = (j == degrees.size() - 1) ? h0_left : 0; h <= h0_left; h++){
+                int min_flux = (h > 0) ? degrees[j] - root * h + ((genera[j] == 0) ? root : 0) : std::max(degrees[j] + ((genera[j] == 0) ? 1 : 0), edge_numbers[j]);
+                int max_flux = (h > 0) ? min_flux : edge_numbers[j] * (root-1);
+                for (int f = std::max(min_flux, edge_numbers[j]); f <= std::min(max_flux, edge_numbers[j] * (root-1)); f++){
+                    if ((degrees[j] - f) % root == 0 && sum + f + min_rest[j+1] <= flux_sum && sum + f + max_rest[j+1] >= flux_sum){
+                        options.push_back(std::make_pair(h, f));
+                    }
+                }
+            }
+            if (options.size() == 0){
+                return 0;
+            }
+            
+            // pick one uniformly
+            std::pair<int, int> option = options[std::uniform_int_distribution<int>(0, (int) options.size() - 1)(generator)];
+            weight *= options.size();
+            partition.push_back(option.first);
+            flux.push_back(option.second);
+            h0_left -= option.first;
+            sum += option.second;
+            
+        }
+        return weight;
+    }
+    
+    // Task: h0 for which the flux is an outflux of these degrees (whatever h0_value), i.e. the sum of the h of the
+    // vertices, which the flux of every vertex determines (h > 0 gives fluxes below those of h = 0).
+    // Output: -1 if the flux is no outflux of these degrees
+    int h0_of(const std::vector<int> & flux) const{
+        int h0 = 0;
+        for (int j = 0; j < degrees.size(); j++){
+            int f = flux[j];
+            if ((degrees[j] - f) % root != 0 || f < edge_numbers[j] || f > edge_numbers[j] * (root-1)){
+                return -1;
+            }
+            h0 += (f >= degrees[j] + ((genera[j] == 0) ? 1 : 0)) ? 0 : (degrees[j] + ((genera[j] == 0) ? root : 0) - f) / root;
+        }
+        return h0;
+    }
+    
+    std::vector<int> degrees;
+    std::vector<int> genera;
+    std::vector<int> edge_numbers;
+    int root;
+    int h0_value;
+    int flux_sum;
+    std::vector<int> min_rest;
+    std::vector<int> max_rest;
+
+};
+
+
+// Task: Draw one importance-sampled descent.
+// Output: weight of the descent (0 if the descent runs into a dead end), outflux_weight = weight of its outflux
+double sample_descent(
+                                const std::vector<int> & genera,
+                                const int root,
+                                const graph_plan & plan,
+                                const outflux_sampler & outfluxes,
+                                const std::vector<std::vector<double>> & partition_weights,
+                                std::mt19937_64 & generator,
+                                double & outflux_weight )
+{
+    
+    // draw an outflux
+    std::vector<int> flux, partition;
+    double weight = outfluxes.draw(generator, flux, partition);
+    outflux_weight = weight;
+    if (weight == 0){
+        return 0;
+    }
+    
+    // descend through the levels
+    std::vector<int> minima, maxima;
+    std::vector<std::vector<int>> flux_partitions;
+    std::vector<double> multiplicities;
+    for (int k = 0; k < plan.number_of_levels(); k++){
+        
+        // compute flux_partitions and their multiplicities
+        if (!level_partitions(root, plan, k, flux, minima, maxima, flux_partitions)){
+            continue;
+        }
+        const stratification_step * steps = plan.level(k);
+        int n = plan.level_size(k);
+        multiplicities.clear();
+        double total_multiplicity = 0;
+        for (int j = 0; j < flux_partitions.size(); j++){
+            double mult = 1;
+            for (int a = 0; a < n; a++){
+                mult *= partition_weights[steps[a].connecting_edges][flux_partitions[j][a]];
+            }
+            multiplicities.push_back(mult);
+            total_multiplicity += mult;
+        }
+        if (total_multiplicity == 0){
+            return 0;
+        }
+        
+        // pick a flux_partition with probability proportional to its multiplicity
+        std::discrete_distribution<int> pick_partition(multiplicities.begin(), multiplicities.end());
+        int j = pick_partition(generator);
+        weight *= total_multiplicity;
+        apply_level_partition(root, plan, k, flux_partitions[j], flux);
+        
+    }
+    
+    // genus factor
+    return weight * genus_factor(genera, root, partition).convert_to<double>();
+    
+}
+
+
+// Task: Draw descents until the deadline is reached (outflux_statistics estimate the number of outfluxes).
+void sample_worker(
+                                const std::vector<int> & genera,
+                                const int root,
+                                const graph_plan & plan,
+                                const outflux_sampler & outfluxes,
+                                const std::vector<std::vector<double>> & partition_weights,
+                                const uint64_t seed,
+                                const std::chrono::steady_clock::time_point deadline,
+                                sample_statistics & statistics,
+                                sample_statistics & outflux_statistics )
+{
+    std::mt19937_64 generator(seed);
+    double outflux_weight;
+    do{
+        for (int s = 0; s < 64; s++){
+            statistics.add(sample_descent(genera, root, plan, outfluxes, partition_weights, generator, outflux_weight));
+            outflux_statistics.add(outflux_weight);
+        }
+    } while (std::chrono::steady_clock::now() < deadline);
+}
+
+
+// Task: Estimate the DFS states of the distributions of a batch of problems (degrees of every problem, h0 from its
+// minimum to h0_max) by uniform random descents (Knuth): the outfluxes are drawn with outflux_sampler and every level
+// with draw_level_partition, so a descent costs O(vertices + edges) however many outfluxes and flux partitions there are.
+// An outflux which m problems of the batch share is counted once by the batch, so each of them gets 1/m of its states.
+// Output: costs[i] = estimated states of problem i (their sum estimates the states of the whole batch)
+std::vector<double> estimate_batch_states(
+                                const std::vector<std::vector<int>> & degrees,
+                                const std::vector<int> & genera,
+                                const std::vector<int> & edge_numbers,
+                                const int & number_of_edges,
+                                const int & root,
+                                const graph_plan & plan,
+                                const std::vector<int> & h0_minima,
+                                const int & h0_max,
+                                const int & samples,
+                                const uint64_t & seed )
+{
+    
+    // (1) samplers of every problem and h0
+    std::vector<std::vector<outflux_sampler>> samplers(degrees.size());
+    for (int i = 0; i < degrees.size(); i++){
+        for (int h0 = h0_minima[i]; h0 <= h0_max; h0++){
+            samplers[i].push_back(outflux_sampler(degrees[i], genera, edge_numbers, number_of_edges, root, h0));
+        }
+    }
+    
+    // (2) descend from the drawn outfluxes
+    std::vector<double> costs(degrees.size(), 0);
+    std::vector<double> level_states(plan.number_of_levels() + 1);
+    std::mt19937_64 generator(seed);
+    std::vector<int> flux, partition;
+    for (int i = 0; i < degrees.size(); i++){
+        for (const outflux_sampler & sampler : samplers[i]){
+            std::fill(level_states.begin(), level_states.end(), 0);
+            for (int s = 0; s < samples; s++){
+                double weight = sampler.draw(generator, flux, partition);
+                if (weight == 0){
+                    continue;
+                }
+                int sharing = 0;
+                for (int j = 0; j < degrees.size(); j++){
+                    int h0 = samplers[j].empty() ? -1 : samplers[j][0].h0_of(flux);
+                    sharing += (h0 >= h0_minima[j] && h0 <= h0_max) ? 1 : 0;
+                }
+                descend_levels(root, plan, flux, weight / sharing, generator, level_states);
+            }
+            costs[i] += std::accumulate(level_states.begin(), level_states.end(), 0.0) / samples;
+        }
+    }
+    return costs;
+    
+}
@@ -3,30 +3,22 @@
 #include <algorithm>
 #include <chrono>
 #include <functional>
+#include <memory>
 #include<fstream>
 #include<iostream>
-#include <mutex>
 #include <numeric>
 #include <sstream>
-#include <stack>
-#include <thread>
 #include <vector>
 #include <boost/multiprecision/cpp_int.hpp>
-#include <boost/thread/mutex.hpp>
-#include <boost/thread/thread.hpp>
-#include "compute_graph_information.cpp"
-
-// guard for thread-safe operations
-boost::mutex myGuard;
-bool display_details = true;
-#include "rootCounter-v2.cpp"
+#include "rootCounter.h"
+#include "driver_options.cpp"
 
 // Optimizations for speedup
 #pragma GCC optimize("Ofast")
-#pragma GCC target("avx,avx2,fma")
 
 // Global variables
-int thread_number = 8;
+int thread_number = 0; // set in main: --threads=<n>, otherwise detected from the hardware and the cgroup CPU quota
+driver_options options;
 
 // #################
 // The main routine
@@ -36,12 +28,18 @@ int thread_number = 8;
 int main(int argc, char* argv[]) {
     
     // check if we have the correct number of arguments
-    if (argc != 2) {
-        std::cout << "Error - number of arguments must be exactly 1 and not " << argc << "\n";
+    if (argc < 2) {
+        std::cout << "Error - number of arguments must be at least 1 and not " << argc - 1 << "\n";
         std::cout << argv[ 0 ] << "\n";
         return 0;
     }
     
+    // parse optional arguments
+    if (!parse_driver_options(argc, argv, 2, options)){
+        return -1;
+    }
+    thread_number = (options.threads > 0) ? options.threads : detect_thread_number();
+    
     // parse input
     std::string myString = argv[1];
     std::stringstream iss( myString );
@@ -74,7 +72,7 @@ int main(int argc, char* argv[]) {
     std::vector<int> flux_vector = {0,0,0,0};
     std::vector<int> genera = {0,1,0,0};
     std::vector<std::vector<int>> edges = {{3,0},{2,0},{2,3},{0,1},{1,3},{1,2}};*/
-        
+    
     // Hard coded information about example
     /*int root = 2;
     int genus = 1;
@@ -96,14 +94,42 @@ int main(int argc, char* argv[]) {
         degrees[i] -= flux_vector[i];
     }
     
-    // compute additional information    
-    std::vector<int> edge_numbers(degrees.size(),0);
-    std::vector<std::vector<std::vector<int>>> graph_stratification;
-    additional_graph_information(edges, edge_numbers, graph_stratification);
-    
-    // count roots
-    boost::multiprecision::int128_t sum = parallel_root_counter(genus, degrees, genera, edges, root, graph_stratification, edge_numbers, input[0], thread_number);
-    std::cout << "Total: " << sum << "\n\n";
+    // count roots (the calling thread takes part in the computation)
+    std::shared_ptr<RootCountGraph> graph = std::make_shared<RootCountGraph>(edges, degrees.size());
+    RootCountThreadPool pool(thread_number - 1, options.pin_threads);
+    graph->replicate(pool);
+    RootCountProblem problem(graph, genus, degrees, genera, root);
+    problem.set_frontier_memory(options.frontier_memory);
+    std::unique_ptr<RootCountProgress> progress;
+    if (options.status_file != "" || options.engine == RootCountEngine::frontier){
+        progress.reset(new RootCountProgress(options.status_file, options.status_interval, thread_number));
+        progress->set_fluxes_total(1);
+        problem.set_progress(progress.get());
+    }
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (options.estimate_seconds > 0){
+        RootCountEstimate estimate = problem.estimate(input[0], options.estimate_seconds, &pool);
+        std::cout << "Samples: " << estimate.samples << " (estimated outfluxes: " << estimate.outfluxes << ")\n";
+        std::cout << "Estimate: " << estimate.estimate << " +- " << estimate.standard_error << "\n";
+        std::cout << "95% confidence interval: [" << estimate.lower << ", " << estimate.upper << "]\n\n";
+        return 0;
+    }
+    boost::multiprecision::cpp_int sum = problem.count(input[0], &pool, options.engine);
+    if (progress){
+        progress->flux_done();
+    }
+    std::chrono::steady_clock::time_point later = std::chrono::steady_clock::now();
+    std::cout << "Time for run: " << std::chrono::duration_cast<std::chrono::seconds>(later - now).count() << "[s]\n";
+    std::cout << "Total: " << sum << "\n";
+    if (options.engine == RootCountEngine::frontier){
+        std::vector<long long> frontiers = progress->frontier_sizes();
+        std::cout << "Frontier sizes:";
+        for (int k = 0; k < frontiers.size(); k++){
+            std::cout << " " << frontiers[k];
+        }
+        std::cout << "\n";
+    }
+    std::cout << "\n";
     
     // return success
     return 0;
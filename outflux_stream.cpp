@@ -0,0 +1,127 @@
+// Bounded stream of outfluxes from one producer (enumerate_outfluxes) to any number of counting threads.
+//
+// The outfluxes are copied into a fixed number of preallocated slots, whose indices are passed around in two bounded
+// lock-free queues (free and filled slots). So the memory does not grow with the number of outfluxes and counting starts
+// with the first outflux. If all slots are filled, the producer counts an outflux itself instead of waiting, so the
+// stream also works if no other thread takes part. Consumers without a filled slot sleep on a condition variable (the
+// producer only takes the lock to wake them if one is sleeping).
+
+
+// Number of slots of a stream
+const int outflux_stream_capacity = 1024;
+
+
+// Consumer of outfluxes (flux, h0 partition)
+typedef std::function<void(const std::vector<int> &, const std::vector<int> &)> outflux_consumer;
+
+
+struct outflux_stream{
+    
+    explicit outflux_stream(const int & capacity) :
+        fluxes(capacity), partitions(capacity), free_slots(capacity + 1), filled_slots(capacity + 1), producer_claimed(false), finished(false), sleeping(0)
+    {
+        for (int slot = 0; slot < capacity; slot++){
+            free_slots.push(slot);
+        }
+    }
+    
+    std::vector<std::vector<int>> fluxes;
+    std::vector<std::vector<int>> partitions;
+    boost::lockfree::queue<int, boost::lockfree::fixed_sized<true>> free_slots;
+    boost::lockfree::queue<int, boost::lockfree::fixed_sized<true>> filled_slots;
+    std::atomic<bool> producer_claimed;
+    std::atomic<bool> finished;
+    std::atomic<int> sleeping;
+    std::mutex mutex;
+    std::condition_variable slot_filled;
+    
+    // wake a sleeping consumer (after a slot was filled or the stream was finished)
+    void wake(const bool & all)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load() > 0){
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+            }
+            if (all){
+                slot_filled.notify_all();
+            }
+            else{
+                slot_filled.notify_one();
+            }
+        }
+    }
+
+};
+
+
+// Task: Count the outfluxes of the stream until it is finished and empty.
+void consume_outflux_stream(outflux_stream & stream, const outflux_consumer & consume)
+{
+    int slot;
+    while (true){
+        if (stream.filled_slots.pop(slot)){
+            consume(stream.fluxes[slot], stream.partitions[slot]);
+            stream.free_slots.push(slot);
+        }
+        else if (stream.finished.load()){
+            // all outfluxes were pushed before the stream was finished
+            while (stream.filled_slots.pop(slot)){
+                consume(stream.fluxes[slot], stream.partitions[slot]);
+                stream.free_slots.push(slot);
+            }
+            return;
+        }
+        else{
+            // sleep until a slot is filled or the stream is finished
+            std::unique_lock<std::mutex> lock(stream.mutex);
+            stream.sleeping++;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool popped = false;
+            stream.slot_filled.wait(lock, [&stream, &slot, &popped]{
+                popped = stream.filled_slots.pop(slot);
+                return popped || stream.finished.load();
+            });
+            stream.sleeping--;
+            lock.unlock();
+            if (popped){
+                consume(stream.fluxes[slot], stream.partitions[slot]);
+                stream.free_slots.push(slot);
+            }
+        }
+    }
+}
+
+
+// Task: Take part in the stream. The first thread to call this produces the outfluxes (so the stream never waits for a
+// producer which has not started), all other threads count them.
+// Input: produce(push) calls push once per outflux, consume(flux, partition) counts one outflux.
+void stream_outfluxes(outflux_stream & stream, const std::function<void(const outflux_consumer &)> & produce, const outflux_consumer & consume)
+{
+    
+    // count outfluxes
+    if (stream.producer_claimed.exchange(true)){
+        consume_outflux_stream(stream, consume);
+        return;
+    }
+    
+    // produce outfluxes (and count one if all slots are filled)
+    produce([&stream, &consume](const std::vector<int> & flux, const std::vector<int> & partition){
+        int slot;
+        while (!stream.free_slots.pop(slot)){
+            int filled;
+            if (stream.filled_slots.pop(filled)){
+                consume(stream.fluxes[filled], stream.partitions[filled]);
+                stream.free_slots.push(filled);
+            }
+        }
+        stream.fluxes[slot] = flux;
+        stream.partitions[slot] = partition;
+        stream.filled_slots.push(slot);
+        stream.wake(false);
+    });
+    stream.finished = true;
+    stream.wake(true);
+    consume_outflux_stream(stream, consume);
+    
+}
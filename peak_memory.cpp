@@ -0,0 +1,25 @@
+// Peak resident memory of the process, for the benchmark and the memory checks
+
+
+// Reset the peak memory of this process (Linux), so every run is measured on its own
+void reset_peak_memory()
+{
+    std::ofstream ofile("/proc/self/clear_refs");
+    ofile << "5";
+}
+
+
+// Peak resident memory in KiB since the last reset (without /proc: since the start of the process)
+long peak_memory()
+{
+    std::ifstream ifile("/proc/self/status");
+    std::string line;
+    while (std::getline(ifile, line)){
+        if (line.compare(0, 6, "VmHWM:") == 0){
+            return std::atol(line.c_str() + 6);
+        }
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
@@ -0,0 +1,210 @@
+// Progress, throughput and ETA reporting (see RootCountProgress in rootCounter.h)
+
+
+// Task: Exponential moving average of rates (the first measurement initializes the average).
+double moving_average(const double & average, const double & value, const bool & first)
+{
+    const double alpha = 0.3;
+    return first ? value : alpha * value + (1 - alpha) * average;
+}
+
+
+// Generation of the last progress object (identifies an object even if a later one reuses its address)
+std::atomic<long long> progress_generations(0);
+
+
+// Number of progress objects whose slot every thread remembers
+const int progress_cached_objects = 8;
+
+
+RootCountProgress::RootCountProgress(const std::string & status_file, const double & interval_seconds, const int & number_of_slots) :
+    status_file(status_file), interval_seconds(interval_seconds), generation(++progress_generations), number_of_slots(std::max(number_of_slots, 1)), slots(std::max(number_of_slots, 1)),
+    next_slot(0), fluxes_done(0), fluxes_total(0), last_fluxes(0), last_outfluxes(0), last_states(0),
+    last_slot_states(std::max(number_of_slots, 1), 0), flux_rate(0), outflux_rate(0), state_rate(0),
+    slot_state_rates(std::max(number_of_slots, 1), 0), frontier_fallbacks(0), stopping(false)
+{
+    start_time = std::chrono::steady_clock::now();
+    last_time = start_time;
+    if (status_file != ""){
+        reporter = boost::thread([this](){ report(); });
+    }
+}
+
+
+RootCountProgress::~RootCountProgress()
+{
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex);
+        stopping = true;
+    }
+    stop_condition.notify_all();
+    if (reporter.joinable()){
+        reporter.join();
+    }
+    write_status();
+}
+
+
+void RootCountProgress::set_fluxes_total(const long long & total)
+{
+    fluxes_total = total;
+}
+
+
+void RootCountProgress::flux_done(const int & n)
+{
+    fluxes_done.fetch_add(n, std::memory_order_relaxed);
+}
+
+
+long long RootCountProgress::states_visited() const
+{
+    long long states = 0;
+    for (int i = 0; i < number_of_slots; i++){
+        states += slots[i].states.load(std::memory_order_relaxed);
+    }
+    return states;
+}
+
+
+void RootCountProgress::frontier_level(const int & level, const long long & states)
+{
+    std::lock_guard<std::mutex> lock(frontier_mutex);
+    if (largest_frontiers.size() <= level){
+        largest_frontiers.resize(level + 1, 0);
+    }
+    largest_frontiers[level] = std::max(largest_frontiers[level], states);
+}
+
+
+void RootCountProgress::frontier_fallback()
+{
+    std::lock_guard<std::mutex> lock(frontier_mutex);
+    frontier_fallbacks++;
+}
+
+
+std::vector<long long> RootCountProgress::frontier_sizes() const
+{
+    std::lock_guard<std::mutex> lock(frontier_mutex);
+    return largest_frontiers;
+}
+
+
+progress_counters * RootCountProgress::counters()
+{
+    
+    // every thread remembers its slot in the last few progress objects (by generation), so a pool thread which alternates
+    // between them keeps one slot in each instead of drawing a new one on every switch
+    static thread_local long long owners[progress_cached_objects] = {0};
+    static thread_local int owner_slots[progress_cached_objects] = {0};
+    static thread_local int next_entry = 0;
+    for (int i = 0; i < progress_cached_objects; i++){
+        if (owners[i] == generation){
+            return &slots[owner_slots[i]];
+        }
+    }
+    int entry = next_entry;
+    next_entry = (next_entry + 1) % progress_cached_objects;
+    owners[entry] = generation;
+    owner_slots[entry] = next_slot.fetch_add(1) % number_of_slots;
+    return &slots[owner_slots[entry]];
+    
+}
+
+
+// Write the status file every interval_seconds until stopped
+void RootCountProgress::report()
+{
+    std::unique_lock<std::mutex> lock(stop_mutex);
+    while (!stopping){
+        stop_condition.wait_for(lock, std::chrono::duration<double>(interval_seconds));
+        if (!stopping){
+            write_status();
+        }
+    }
+}
+
+
+void RootCountProgress::write_status()
+{
+    
+    if (status_file == ""){
+        return;
+    }
+    std::lock_guard<std::mutex> lock(report_mutex);
+    
+    // (1) read the counters
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - start_time).count();
+    double delta = std::chrono::duration<double>(now - last_time).count();
+    long long fluxes = fluxes_done.load(std::memory_order_relaxed);
+    long long total = fluxes_total.load(std::memory_order_relaxed);
+    long long outfluxes = 0;
+    long long states = 0;
+    std::vector<long long> slot_states(number_of_slots, 0);
+    for (int i = 0; i < number_of_slots; i++){
+        outfluxes += slots[i].outfluxes.load(std::memory_order_relaxed);
+        slot_states[i] = slots[i].states.load(std::memory_order_relaxed);
+        states += slot_states[i];
+    }
+    
+    // (2) update the moving averages of the rates
+    if (delta > 0){
+        bool first = (last_time == start_time);
+        flux_rate = moving_average(flux_rate, (fluxes - last_fluxes) / delta, first);
+        outflux_rate = moving_average(outflux_rate, (outfluxes - last_outfluxes) / delta, first);
+        state_rate = moving_average(state_rate, (states - last_states) / delta, first);
+        for (int i = 0; i < number_of_slots; i++){
+            slot_state_rates[i] = moving_average(slot_state_rates[i], (slot_states[i] - last_slot_states[i]) / delta, first);
+        }
+        last_time = now;
+        last_fluxes = fluxes;
+        last_outfluxes = outfluxes;
+        last_states = states;
+        last_slot_states = slot_states;
+    }
+    std::vector<long long> frontiers;
+    long long fallbacks;
+    {
+        std::lock_guard<std::mutex> frontier_lock(frontier_mutex);
+        frontiers = largest_frontiers;
+        fallbacks = frontier_fallbacks;
+    }
+    long long remaining = std::max(total - fluxes, (long long) 0);
+    double eta = (remaining == 0) ? 0 : ((flux_rate > 0) ? remaining / flux_rate : -1);
+    
+    // (3) write the status file (to a temporary file first, so readers never see a partial file)
+    std::string temporary_file = status_file + ".tmp";
+    std::ofstream ofile(temporary_file.c_str());
+    ofile << "{\n";
+    ofile << "  \"elapsed_seconds\": " << elapsed << ",\n";
+    ofile << "  \"fluxes_done\": " << fluxes << ",\n";
+    ofile << "  \"fluxes_total\": " << total << ",\n";
+    ofile << "  \"fluxes_remaining\": " << remaining << ",\n";
+    ofile << "  \"fluxes_per_second\": " << flux_rate << ",\n";
+    ofile << "  \"outfluxes_done\": " << outfluxes << ",\n";
+    ofile << "  \"outfluxes_per_second\": " << outflux_rate << ",\n";
+    ofile << "  \"states_visited\": " << states << ",\n";
+    ofile << "  \"states_per_second\": " << state_rate << ",\n";
+    ofile << "  \"eta_seconds\": " << eta << ",\n";
+    ofile << "  \"frontier_sizes\": [";
+    for (int k = 0; k < frontiers.size(); k++){
+        ofile << frontiers[k] << ((k < frontiers.size() - 1) ? ", " : "");
+    }
+    ofile << "],\n";
+    ofile << "  \"frontier_fallbacks\": " << fallbacks << ",\n";
+    ofile << "  \"threads\": [\n";
+    int used_slots = std::min(next_slot.load(), number_of_slots);
+    for (int i = 0; i < used_slots; i++){
+        ofile << "    {\"slot\": " << i << ", \"active\": " << (slots[i].active.load(std::memory_order_relaxed) > 0 ? "true" : "false");
+        ofile << ", \"outfluxes_done\": " << slots[i].outfluxes.load(std::memory_order_relaxed);
+        ofile << ", \"states_visited\": " << slot_states[i];
+        ofile << ", \"states_per_second\": " << slot_state_rates[i] << "}" << ((i < used_slots - 1) ? "," : "") << "\n";
+    }
+    ofile << "  ]\n";
+    ofile << "}\n";
+    ofile.close();
+    std::rename(temporary_file.c_str(), status_file.c_str());
+    
+}
@@ -0,0 +1,1025 @@
+// Library for counting (limit) root bundles on full blowups of nodal curves (see rootCounter.h)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <sstream>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include <stack>
+#include <unordered_map>
+#include <boost/lockfree/queue.hpp>
+#include "rootCounter.h"
+
+// Optimizations for speedup (the instruction set of the counting kernels is chosen at runtime, see cpu_dispatch.cpp)
+#pragma GCC optimize("Ofast")
+
+#include "compute_graph_information.cpp"
+#include "outflux_stream.cpp"
+#include "rootCounter-v2.cpp"
+#include "modular_counter.cpp"
+#include "cpu_dispatch.cpp"
+#include "meet_in_the_middle.cpp"
+#include "frontier_engine.cpp"
+#include "flux_batching.cpp"
+#include "closed_form_total.cpp"
+#include "monte_carlo_estimator.cpp"
+#include "progress_monitor.cpp"
+#include "hardware_topology.cpp"
+
+
+
+// #################
+// Thread pool
+// Thread pool
+// #################
+
+RootCountThreadPool::RootCountThreadPool(const int & thread_number, const bool & pin_threads) :
+    thread_number(thread_number >= 0 ? thread_number : detect_thread_number() - 1), next_node(0), stopping(false)
+{
+    
+    // (1) topology
+    node_cpus = numa_node_cpus();
+    for (int node = 0; node < node_cpus.size(); node++){
+        for (int cpu : node_cpus[node]){
+            if (cpu_nodes.size() <= cpu){
+                cpu_nodes.resize(cpu + 1, 0);
+            }
+            cpu_nodes[cpu] = node;
+        }
+    }
+    node_threads.resize(node_cpus.size(), 0);
+    tasks.resize(node_cpus.size());
+    
+    // (2) start the threads, spread round-robin over the nodes (and over the CPUs of each node)
+    for (int i = 0; i < this->thread_number; i++){
+        int node = i % node_cpus.size();
+        int cpu = node_cpus[node][(i / node_cpus.size()) % node_cpus[node].size()];
+        node_threads[node]++;
+        boost::thread * t = threads.create_thread([this, node](){ run(node); });
+        if (pin_threads){
+            set_thread_affinity(t->native_handle(), {cpu});
+        }
+        else if (node_cpus.size() > 1){
+            set_thread_affinity(t->native_handle(), node_cpus[node]);
+        }
+    }
+    
+}
+
+
+RootCountThreadPool::~RootCountThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex);
+        stopping = true;
+    }
+    tasks_condition.notify_all();
+    threads.join_all();
+}
+
+
+int RootCountThreadPool::size() const
+{
+    return thread_number;
+}
+
+
+int RootCountThreadPool::number_of_nodes() const
+{
+    return node_cpus.size();
+}
+
+
+int RootCountThreadPool::threads_on_node(const int & node) const
+{
+    return node_threads[node];
+}
+
+
+int RootCountThreadPool::current_node() const
+{
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    if (cpu >= 0 && cpu < cpu_nodes.size()){
+        return cpu_nodes[cpu];
+    }
+#endif
+    return 0;
+}
+
+
+void RootCountThreadPool::post(const std::function<void()> & task, const int & node, const bool & bound)
+{
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex);
+        int target = node;
+        if (target < 0 || target >= tasks.size()){
+            target = next_node;
+            next_node = (next_node + 1) % tasks.size();
+        }
+        queued_task entry;
+        entry.task = task;
+        entry.bound = bound;
+        tasks[target].push_back(entry);
+    }
+    tasks_condition.notify_all();
+}
+
+
+void RootCountThreadPool::run(const int & node)
+{
+    
+    // find a task: first on the own node, then steal unbound tasks of other nodes
+    auto find_task = [this, node](std::function<void()> & task){
+        for (int offset = 0; offset < tasks.size(); offset++){
+            std::deque<queued_task> & queue = tasks[(node + offset) % tasks.size()];
+            for (std::deque<queued_task>::iterator it = queue.begin(); it != queue.end(); it++){
+                if (offset == 0 || !it->bound){
+                    task = it->task;
+                    queue.erase(it);
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+    
+    while (true){
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(tasks_mutex);
+            tasks_condition.wait(lock, [&](){ return stopping || find_task(task); });
+            if (!task){
+                return;
+            }
+        }
+        task();
+    }
+    
+}
+
+
+// Run task(0, node), ..., task(packages-1, node) on the pool, where node is the NUMA node of the thread running the package.
+// The packages are split into contiguous blocks, one per NUMA node; threads first work on the block of their own node
+// and then help with the other blocks.
+// The calling thread processes packages as well and only waits for packages which are already being processed,
+// so this never blocks on queued tasks (even if all threads of the pool are busy or call this function themselves).
+void run_packages(RootCountThreadPool * pool, const int & packages, const std::function<void(int, int)> & task)
+{
+    
+    struct package_state{
+        std::function<void(int, int)> task;
+        int packages;
+        int nodes;
+        std::unique_ptr<std::atomic<int>[]> next;
+        int done;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+    std::shared_ptr<package_state> state = std::make_shared<package_state>();
+    state->task = task;
+    state->packages = packages;
+    state->nodes = (pool == nullptr) ? 1 : pool->number_of_nodes();
+    state->next.reset(new std::atomic<int>[state->nodes]);
+    for (int node = 0; node < state->nodes; node++){
+        state->next[node] = node * packages / state->nodes;
+    }
+    state->done = 0;
+    
+    // process packages until none are left (starting with the block of the own node)
+    std::function<void(int)> process = [state](int node){
+        for (int offset = 0; offset < state->nodes; offset++){
+            int block = (node + offset) % state->nodes;
+            int end = (block + 1) * state->packages / state->nodes;
+            while (true){
+                int i = state->next[block]++;
+                if (i >= end){
+                    break;
+                }
+                state->task(i, node);
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->done++;
+                if (state->done == state->packages){
+                    state->condition.notify_all();
+                }
+            }
+        }
+    };
+    
+    // start helpers on every node and participate
+    if (pool != nullptr){
+        int helpers = std::min(pool->size(), packages - 1);
+        for (int node = 0; node < state->nodes; node++){
+            int node_helpers = (pool->size() == 0) ? 0 : (helpers * pool->threads_on_node(node) + pool->size() - 1) / pool->size();
+            for (int i = 0; i < node_helpers; i++){
+                pool->post([process, node](){ process(node); }, node);
+            }
+        }
+    }
+    process((pool == nullptr) ? 0 : pool->current_node());
+    
+    // wait for the packages processed by the helpers
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->condition.wait(lock, [&state](){ return state->done == state->packages; });
+    
+}
+
+
+// Counters of the calling thread for a package (nullptr if no progress is reported)
+progress_counters * start_package(RootCountProgress * progress)
+{
+    if (progress == nullptr){
+        return nullptr;
+    }
+    progress_counters * counters = progress->counters();
+    counters->active.fetch_add(1, std::memory_order_relaxed);
+    return counters;
+}
+
+
+void finish_package(progress_counters * counters)
+{
+    if (counters != nullptr){
+        counters->active.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+
+// Number of packages in which the outfluxes are split
+int number_of_packages(RootCountThreadPool * pool, const int & number_of_outfluxes)
+{
+    int threads = (pool == nullptr) ? 1 : pool->size() + 1;
+    return std::max(1, std::min(number_of_outfluxes, 4 * threads));
+}
+
+
+// Level-synchronous count (see frontier_engine.cpp): sums of the multiplicities of the states on the last level which are
+// reached from the frontier on level 0, per tag. The frontier is consumed.
+std::vector<boost::multiprecision::int128_t> count_frontier(
+                     RootCountThreadPool * pool,
+                     RootCountProgress * progress,
+                     const RootCountGraph & graph,
+                     const int & root,
+                     flux_frontier & frontier,
+                     const int & number_of_tags,
+                     const size_t & memory_budget )
+{
+    
+    // (1) expand and aggregate one level at a time, as long as the frontier fits into the memory budget
+    int levels = graph.plan.number_of_levels();
+    long long budget_states = memory_budget / frontier_state_bytes(graph.edge_numbers.size() + 1);
+    int k = 0;
+    while (k < levels && frontier.size() > 0){
+        if (progress != nullptr){
+            progress->frontier_level(k, frontier.size());
+        }
+        
+        // (1.1) every package expands a part of the frontier into the shared shards (the old frontier and the new states
+        // together stay within the budget up to one buffer per package, and so do the shards and the next frontier which is
+        // copied from them)
+        int packages = number_of_packages(pool, frontier.size());
+        int package_size = (int) frontier.size()/packages;
+        std::vector<flux_table> shards(packages);
+        std::vector<std::mutex> shard_locks(packages);
+        long long state_limit = std::min(budget_states - (long long) frontier.size(), budget_states / 2);
+        std::atomic<long long> new_states(0);
+        std::atomic<bool> exceeded(false);
+        run_packages(pool, packages, [&](int i, int node){
+            int first = i * package_size;
+            int last = (i < packages - 1) ? (i+1) * package_size : (int) frontier.size();
+            progress_counters * counters = start_package(progress);
+            expand_frontier_worker(root, graph.plan_for_node(node), k, frontier, first, last, shards, shard_locks, state_limit, new_states, exceeded, counters);
+            finish_package(counters);
+        });
+        if (exceeded){
+            if (progress != nullptr){
+                progress->frontier_fallback();
+            }
+            break;
+        }
+        
+        // (1.2) the outfluxes (the states on level 0) are done once level 0 is aggregated
+        if (k == 0){
+            progress_counters * counters = start_package(progress);
+            if (counters != nullptr){
+                counters->outfluxes.fetch_add(frontier.size(), std::memory_order_relaxed);
+            }
+            finish_package(counters);
+        }
+        
+        // (1.3) the shards are the next frontier
+        std::vector<size_t> offsets(packages + 1, 0);
+        for (int s = 0; s < packages; s++){
+            offsets[s + 1] = offsets[s] + shards[s].size();
+        }
+        flux_frontier().swap(frontier);
+        frontier.resize(offsets[packages]);
+        run_packages(pool, packages, [&](int s, int){
+            std::copy(shards[s].begin(), shards[s].end(), frontier.begin() + offsets[s]);
+            flux_table().swap(shards[s]);
+        });
+        k++;
+    }
+    
+    // (2) count the remaining levels depth-first (nothing is left to expand if all levels were aggregated)
+    if (progress != nullptr && k == levels){
+        progress->frontier_level(k, frontier.size());
+    }
+    std::vector<boost::multiprecision::int128_t> sums(number_of_tags, 0);
+    if (frontier.size() == 0){
+        return sums;
+    }
+    int packages = number_of_packages(pool, frontier.size());
+    int package_size = (int) frontier.size()/packages;
+    std::vector<boost::multiprecision::int128_t> counts(frontier.size(), 0);
+    run_packages(pool, packages, [&](int i, int node){
+        int first = i * package_size;
+        int last = (i < packages - 1) ? (i+1) * package_size : (int) frontier.size();
+        progress_counters * counters = start_package(progress);
+        finish_frontier_worker(root, graph.plan_for_node(node), k, frontier, first, last, counts, counters);
+        finish_package(counters);
+    });
+    for (int i = 0; i < frontier.size(); i++){
+        sums[frontier[i].first.back()] += counts[i];
+    }
+    return sums;
+    
+}
+
+
+
+// #################
+// Graph information
+// Graph information
+// #################
+
+RootCountGraph::RootCountGraph(const std::vector<std::vector<int>> & edges, const int & number_of_vertices) : edges(edges), edge_numbers(number_of_vertices, 0)
+{
+    additional_graph_information(this->edges, edge_numbers, graph_stratification);
+    plan = compile_graph_plan(graph_stratification);
+}
+
+
+std::shared_ptr<const std::map<std::vector<int>, boost::multiprecision::cpp_int>> RootCountGraph::total_leaves(const std::vector<int> & special, const int & root) const
+{
+    
+    // (1) look up the leaves of these special vertices
+    std::vector<int> key(1, root);
+    key.insert(key.end(), special.begin(), special.end());
+    std::lock_guard<std::mutex> lock(total_mutex);
+    std::map<std::vector<int>, std::shared_ptr<const std::map<std::vector<int>, boost::multiprecision::cpp_int>>>::const_iterator it = total_cache.find(key);
+    if (it != total_cache.end()){
+        return it->second;
+    }
+    
+    // (2) otherwise expand the edges between the other vertices (unless there are too many)
+    std::vector<std::vector<int>> others;
+    for (const std::vector<int> & edge : edges){
+        if (special[edge[0]] == 0 && special[edge[1]] == 0){
+            others.push_back(edge);
+        }
+    }
+    std::shared_ptr<std::map<std::vector<int>, boost::multiprecision::cpp_int>> leaves;
+    if (others.size() <= total_edge_limit){
+        leaves = std::make_shared<std::map<std::vector<int>, boost::multiprecision::cpp_int>>();
+        std::vector<int> representatives(special.size());
+        std::iota(representatives.begin(), representatives.end(), 0);
+        deletion_contraction(others, representatives, 1, root, *leaves);
+    }
+    total_cache[key] = leaves;
+    return leaves;
+    
+}
+
+
+void RootCountGraph::replicate(RootCountThreadPool & pool)
+{
+    node_plans.assign(pool.number_of_nodes(), nullptr);
+    if (pool.number_of_nodes() == 1){
+        return;
+    }
+    for (int node = 0; node < pool.number_of_nodes(); node++){
+        if (pool.threads_on_node(node) == 0){
+            continue;
+        }
+        std::shared_ptr<std::promise<void>> copied = std::make_shared<std::promise<void>>();
+        std::future<void> ready = copied->get_future();
+        pool.post([this, node, copied](){
+            node_plans[node] = std::make_shared<const graph_plan>(plan);
+            copied->set_value();
+        }, node, true);
+        ready.wait();
+    }
+}
+
+
+const graph_plan & RootCountGraph::plan_for_node(const int & node) const
+{
+    if (node >= 0 && node < node_plans.size() && node_plans[node]){
+        return *node_plans[node];
+    }
+    return plan;
+}
+
+
+
+// #################
+// Root count problem
+// Root count problem
+// #################
+
+RootCountProblem::RootCountProblem(
+                     const int & genus,
+                     const std::vector<int> & degrees,
+                     const std::vector<int> & genera,
+                     const std::vector<std::vector<int>> & edges,
+                     const int & root ) :
+    graph(std::make_shared<RootCountGraph>(edges, degrees.size())), genus(genus), degrees(degrees), genera(genera), root(root), progress(nullptr), frontier_memory(frontier_default_memory)
+{
+    initialize();
+}
+
+
+RootCountProblem::RootCountProblem(
+                     const std::shared_ptr<const RootCountGraph> & graph,
+                     const int & genus,
+                     const std::vector<int> & degrees,
+                     const std::vector<int> & genera,
+                     const int & root ) :
+    graph(graph), genus(genus), degrees(degrees), genera(genera), root(root), progress(nullptr), frontier_memory(frontier_default_memory)
+{
+    initialize();
+}
+
+
+void RootCountProblem::initialize()
+{
+    primes = crt_primes(crt_number_of_primes(root_count_bound(genera, graph->edges, root)));
+    for (int q = 0; q < primes.size(); q++){
+        partition_tables.push_back(number_partitions_table_mod(graph->plan.max_connecting_edges, root, primes[q]));
+    }
+}
+
+
+void RootCountProblem::set_progress(RootCountProgress * progress)
+{
+    this->progress = progress;
+}
+
+
+void RootCountProblem::set_frontier_memory(const size_t & bytes)
+{
+    frontier_memory = bytes;
+}
+
+
+int RootCountProblem::h0_min() const
+{
+    int total_degree = std::accumulate(degrees.begin(), degrees.end(), 0);
+    return std::max(0, (int)(total_degree/root) - genus + 1);
+}
+
+
+int RootCountProblem::h0_top() const
+{
+    return closed_form_h0_top(degrees, genera, graph->edge_numbers, root);
+}
+
+
+boost::multiprecision::cpp_int RootCountProblem::total() const
+{
+    return closed_form_total(degrees, genera, *graph, root);
+}
+
+
+double RootCountProblem::predicted_cost(const int & h0_max) const
+{
+    
+    // random descents from sampled outfluxes for every h0 (nothing is enumerated)
+    double cost = estimate_batch_states({degrees}, genera, graph->edge_numbers, graph->edges.size(), root, graph->plan,
+                                        {h0_min()}, h0_max, 256, 31)[0];
+    return cost;
+    
+}
+
+
+void RootCountProblem::outfluxes_for(
+                     const int & h0_value,
+                     std::vector<std::vector<int>> & outfluxes,
+                     std::vector<std::vector<int>> & h0_partitions ) const
+{
+    
+    // (1) Partition h0
+    std::vector<std::vector<int>> partitions;
+    comp_partitions(h0_value, degrees.size(), std::vector<int>(degrees.size(),0), std::vector<int>(degrees.size(),h0_value), partitions);
+    
+    // (2) Find fluxes corresponding to partitions
+    compute_outfluxes(degrees, genera, graph->edges, root, graph->edge_numbers, partitions, outfluxes, h0_partitions);
+    
+}
+
+
+boost::multiprecision::cpp_int RootCountProblem::count(
+                     const int & h0_value,
+                     RootCountThreadPool * pool,
+                     const RootCountEngine & engine ) const
+{
+    
+    // check for degenerate case: h0_min > h0_value
+    if (h0_value < h0_min()){
+        return 0;
+    }
+    
+    // (1) Meet-in-the-middle: find all outfluxes for this h0 (they are needed to choose the split) and count in packages
+    // (1) Meet-in-the-middle: find all outfluxes for this h0 (they are needed to choose the split) and count in packages
+    if (engine == RootCountEngine::meet_in_the_middle){
+        
+        std::vector<std::vector<int>> outfluxes;
+        std::vector<std::vector<int>> h0_partitions;
+        outfluxes_for(h0_value, outfluxes, h0_partitions);
+        if (outfluxes.size() == 0){
+            return 0;
+        }
+        int packages = number_of_packages(pool, outfluxes.size());
+        int package_size = (int) outfluxes.size()/packages;
+        
+        // prefix: aggregate the states at the split level per package and merge the tables
+        int split = choose_split(root, graph->plan, outfluxes);
+        std::vector<flux_table> package_tables(packages);
+        run_packages(pool, packages, [&](int i, int node){
+            int first = i * package_size;
+            int last = (i < packages - 1) ? (i+1) * package_size : (int) outfluxes.size();
+            progress_counters * counters = start_package(progress);
+            prefix_worker(genera, root, graph->plan_for_node(node), split, outfluxes, h0_partitions, first, last, package_tables[i], counters);
+            finish_package(counters);
+        });
+        for (int i = 1; i < packages; i++){
+            for (flux_table::const_iterator it = package_tables[i].begin(); it != package_tables[i].end(); it++){
+                package_tables[0][it->first] += it->second;
+            }
+            flux_table().swap(package_tables[i]);
+        }
+        std::vector<std::pair<std::vector<int>, boost::multiprecision::int128_t>> keys(package_tables[0].begin(), package_tables[0].end());
+        flux_table().swap(package_tables[0]);
+        if (keys.size() == 0){
+            return 0;
+        }
+        
+        // suffix: count once per key and join
+        int key_packages = number_of_packages(pool, keys.size());
+        int key_package_size = (int) keys.size()/key_packages;
+        std::vector<boost::multiprecision::int128_t> key_package_sums(key_packages, 0);
+        run_packages(pool, key_packages, [&](int i, int node){
+            int first = i * key_package_size;
+            int last = (i < key_packages - 1) ? (i+1) * key_package_size : (int) keys.size();
+            progress_counters * counters = start_package(progress);
+            suffix_worker(root, graph->plan_for_node(node), split, keys, first, last, key_package_sums[i], counters);
+            finish_package(counters);
+        });
+        boost::multiprecision::int128_t sum = 0;
+        for (int i = 0; i < key_packages; i++){
+            sum += key_package_sums[i];
+        }
+        return (boost::multiprecision::cpp_int) sum;
+        
+    }
+    
+    // (1.5) Frontier: all outfluxes (with their genus factors) form the frontier on level 0, whose states are merged
+    // (1.5) Frontier: all outfluxes (with their genus factors) form the frontier on level 0, whose states are merged
+    if (engine == RootCountEngine::frontier){
+        std::vector<std::vector<int>> outfluxes;
+        std::vector<std::vector<int>> h0_partitions;
+        outfluxes_for(h0_value, outfluxes, h0_partitions);
+        flux_frontier frontier = initial_frontier(genera, root, outfluxes, h0_partitions, false);
+        return (boost::multiprecision::cpp_int) count_frontier(pool, progress, *graph, root, frontier, 1, frontier_memory)[0];
+    }
+    
+    // (2) Otherwise stream the outfluxes for this h0 into the packages, which count them as they come
+    // (2) Otherwise stream the outfluxes for this h0 into the packages, which count them as they come
+    std::vector<std::vector<int>> partitions;
+    comp_partitions(h0_value, degrees.size(), std::vector<int>(degrees.size(),0), std::vector<int>(degrees.size(),h0_value), partitions);
+    outflux_stream stream(outflux_stream_capacity);
+    std::function<void(const outflux_consumer &)> produce = [&](const outflux_consumer & push){
+        enumerate_outfluxes(degrees, genera, graph->edges, root, graph->edge_numbers, partitions, push);
+    };
+    int packages = (pool == nullptr) ? 1 : pool->size() + 1;
+    if (engine == RootCountEngine::modular){
+        int number_of_primes = primes.size();
+        std::vector<uint64_t> package_sums(packages * number_of_primes, 0);
+        run_packages(pool, packages, [&](int i, int node){
+            const graph_plan & plan = graph->plan_for_node(node);
+            progress_counters * counters = start_package(progress);
+            stream_outfluxes(stream, produce, [&](const std::vector<int> & flux, const std::vector<int> & partition){
+                for (int q = 0; q < number_of_primes; q++){
+                    uint64_t & sum = package_sums[i * number_of_primes + q];
+                    sum += modular_count_outflux(genera, root, plan, flux, partition, primes[q], partition_tables[q], counters);
+                    if (sum >= primes[q]){
+                        sum -= primes[q];
+                    }
+                }
+            });
+            finish_package(counters);
+        });
+        std::vector<uint64_t> residues(number_of_primes, 0);
+        for (int q = 0; q < number_of_primes; q++){
+            for (int i = 0; i < packages; i++){
+                residues[q] = (residues[q] + package_sums[i * number_of_primes + q]) % primes[q];
+            }
+        }
+        return crt_reconstruct(residues, primes);
+    }
+    std::vector<boost::multiprecision::int128_t> package_sums(packages, 0);
+    run_packages(pool, packages, [&](int i, int node){
+        const graph_plan & plan = graph->plan_for_node(node);
+        progress_counters * counters = start_package(progress);
+        stream_outfluxes(stream, produce, [&](const std::vector<int> & flux, const std::vector<int> & partition){
+            package_sums[i] += count_outflux(genera, root, plan, flux, partition, counters);
+        });
+        finish_package(counters);
+    });
+    boost::multiprecision::int128_t sum = 0;
+    for (int i = 0; i < packages; i++){
+        sum += package_sums[i];
+    }
+    return (boost::multiprecision::cpp_int) sum;
+    
+}
+
+
+std::vector<boost::multiprecision::cpp_int> RootCountProblem::distribution(
+                     const int & h0_max,
+                     RootCountThreadPool * pool,
+                     const RootCountEngine & engine ) const
+{
+    std::vector<boost::multiprecision::cpp_int> dist(h0_max + 1, 0);
+    for (int j = h0_min(); j <= h0_max; j++){
+        dist[j] = count(j, pool, engine);
+    }
+    return dist;
+}
+
+
+RootCountEstimate RootCountProblem::estimate(
+                     const int & h0_value,
+                     const double & seconds,
+                     RootCountThreadPool * pool,
+                     const double & z,
+                     const uint64_t & seed ) const
+{
+    
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+    RootCountEstimate result = {0, 0, 0, 0, 0, 0};
+    
+    // (1) Draw the outfluxes for this h0 as the descents go (so the time budget also covers them)
+    // (1) Draw the outfluxes for this h0 as the descents go (so the time budget also covers them)
+    if (h0_value < h0_min()){
+        return result;
+    }
+    outflux_sampler outfluxes(degrees, genera, graph->edge_numbers, graph->edges.size(), root, h0_value);
+    
+    // (2) Sample descents in parallel until the deadline (each thread has its own generator and statistics)
+    // (2) Sample descents in parallel until the deadline (each thread has its own generator and statistics)
+    const graph_plan & plan = graph->plan;
+    std::vector<std::vector<boost::multiprecision::int128_t>> table = number_partitions_table(plan.max_connecting_edges, root);
+    std::vector<std::vector<double>> partition_weights(table.size());
+    for (int n = 0; n < table.size(); n++){
+        for (int f = 0; f < table[n].size(); f++){
+            partition_weights[n].push_back(table[n][f].convert_to<double>());
+        }
+    }
+    uint64_t base_seed = (seed != 0) ? seed : std::random_device()();
+    int packages = (pool == nullptr) ? 1 : pool->size() + 1;
+    std::vector<sample_statistics> package_statistics(packages);
+    std::vector<sample_statistics> package_outflux_statistics(packages);
+    run_packages(pool, packages, [&](int i, int node){
+        sample_worker(genera, root, graph->plan_for_node(node), outfluxes, partition_weights, base_seed + 7919 * i, deadline, package_statistics[i], package_outflux_statistics[i]);
+    });
+    
+    // (3) Merge the statistics and compute the confidence interval
+    // (3) Merge the statistics and compute the confidence interval
+    sample_statistics statistics;
+    sample_statistics outflux_statistics;
+    for (int i = 0; i < packages; i++){
+        statistics.merge(package_statistics[i]);
+        outflux_statistics.merge(package_outflux_statistics[i]);
+    }
+    result.samples = statistics.samples;
+    result.outfluxes = (long long) std::llround(outflux_statistics.mean);
+    result.estimate = statistics.mean;
+    if (statistics.samples > 1){
+        result.standard_error = std::sqrt(statistics.m2 / (statistics.samples - 1) / statistics.samples);
+    }
+    result.lower = std::max(0.0, result.estimate - z * result.standard_error);
+    result.upper = result.estimate + z * result.standard_error;
+    return result;
+    
+}
+
+
+
+// #################
+// Batch of root count problems
+// Batch of root count problems
+// #################
+
+RootCountBatch::RootCountBatch(
+                   const std::shared_ptr<const RootCountGraph> & graph,
+                   const int & genus,
+                   const std::vector<std::vector<int>> & degrees,
+                   const std::vector<int> & genera,
+                   const int & root ) :
+    graph(graph), genus(genus), degrees(degrees), genera(genera), root(root), progress(nullptr), frontier_memory(frontier_default_memory)
+{
+    primes = crt_primes(crt_number_of_primes(root_count_bound(genera, graph->edges, root)));
+    for (int q = 0; q < primes.size(); q++){
+        partition_tables.push_back(number_partitions_table_mod(graph->plan.max_connecting_edges, root, primes[q]));
+    }
+}
+
+
+void RootCountBatch::set_progress(RootCountProgress * progress)
+{
+    this->progress = progress;
+}
+
+
+void RootCountBatch::set_frontier_memory(const size_t & bytes)
+{
+    frontier_memory = bytes;
+}
+
+
+int RootCountBatch::size() const
+{
+    return degrees.size();
+}
+
+
+std::vector<std::vector<boost::multiprecision::cpp_int>> RootCountBatch::distributions(
+                   const int & h0_max,
+                   RootCountThreadPool * pool,
+                   const RootCountEngine & engine,
+                   const bool & derive ) const
+{
+    
+    // (1) Lowest and highest h0 values of all problems (their outfluxes are found in walks through the trie of the reduced degrees)
+    // (1) Lowest and highest h0 values of all problems (their outfluxes are found in walks through the trie of the reduced degrees)
+    std::vector<int> h0_minima;
+    for (int i = 0; i < degrees.size(); i++){
+        int total_degree = std::accumulate(degrees[i].begin(), degrees[i].end(), 0);
+        h0_minima.push_back(std::max(0, (int)(total_degree/root) - genus + 1));
+    }
+    std::vector<boost::multiprecision::cpp_int> problem_totals = derive ? totals() : std::vector<boost::multiprecision::cpp_int>(degrees.size(), -1);
+    std::vector<int> tops = h0_tops();
+    int h0_last = h0_max;
+    for (int i = 0; i < degrees.size(); i++){
+        h0_last = (problem_totals[i] >= 0) ? std::max(h0_last, tops[i]) : h0_last;
+    }
+    
+    // (1.5) Derive the bucket with the most outfluxes of every problem with a total, if it has more outfluxes than the
+    // buckets above h0_max (which are dropped otherwise); the buckets are sized by a walk which only counts
+    // (1.5) Derive the bucket with the most outfluxes of every problem with a total, if it has more outfluxes than the
+    // buckets above h0_max (which are dropped otherwise); the buckets are sized by a walk which only counts
+    std::vector<int> derived(degrees.size(), -1);
+    if (derive){
+        std::vector<std::vector<long long>> bucket_sizes(degrees.size(), std::vector<long long>(h0_last + 1, 0));
+        walk_batch_outfluxes(degrees, genera, graph->edge_numbers, graph->edges.size(), root, h0_minima, h0_last,
+                             [&bucket_sizes](const std::vector<int> &, const int & h0, const boost::multiprecision::int128_t &, const std::vector<int> & fluxes){
+                                 for (int i : fluxes){
+                                     bucket_sizes[i][h0]++;
+                                 }
+                             });
+        for (int i = 0; i < degrees.size(); i++){
+            if (problem_totals[i] >= 0){
+                int heaviest = std::max_element(bucket_sizes[i].begin(), bucket_sizes[i].begin() + std::min(h0_max, h0_last) + 1) - bucket_sizes[i].begin();
+                long long above = std::accumulate(bucket_sizes[i].begin() + std::min(h0_max, h0_last) + 1, bucket_sizes[i].end(), 0LL);
+                derived[i] = (bucket_sizes[i][heaviest] > above) ? heaviest : -1;
+            }
+        }
+    }
+    
+    // (2) Walk the trie and count the weight assignments of every distinct outflux of a chunk once, whenever the chunk is full
+    // (2) Walk the trie and count the weight assignments of every distinct outflux of a chunk once, whenever the chunk is full
+    std::vector<std::vector<boost::multiprecision::cpp_int>> dists(degrees.size(), std::vector<boost::multiprecision::cpp_int>(h0_last + 1, 0));
+    std::unordered_map<std::vector<int>, int, flux_hash> outflux_index;
+    std::vector<std::vector<int>> outfluxes;
+    std::vector<std::pair<int, batch_entry>> entries;
+    std::function<void()> flush = [&](){
+        std::vector<boost::multiprecision::cpp_int> weights = outflux_weights(outfluxes, pool, engine);
+        for (const std::pair<int, batch_entry> & entry : entries){
+            dists[entry.first][entry.second.h0] += (boost::multiprecision::cpp_int) entry.second.genus_factor * weights[entry.second.outflux];
+        }
+        std::unordered_map<std::vector<int>, int, flux_hash>().swap(outflux_index);
+        std::vector<std::vector<int>>().swap(outfluxes);
+        std::vector<std::pair<int, batch_entry>>().swap(entries);
+    };
+    walk_batch_outfluxes(degrees, genera, graph->edge_numbers, graph->edges.size(), root, h0_minima, h0_last,
+                         [&](const std::vector<int> & flux, const int & h0, const boost::multiprecision::int128_t & genus_factor, const std::vector<int> & fluxes){
+                             int outflux = -1;
+                             for (int i : fluxes){
+                                 int h0_end = (derived[i] >= 0) ? h0_last : h0_max;
+                                 if (h0 == derived[i] || h0 > h0_end){
+                                     continue;
+                                 }
+                                 if (outflux < 0){
+                                     std::unordered_map<std::vector<int>, int, flux_hash>::iterator it = outflux_index.find(flux);
+                                     if (it == outflux_index.end()){
+                                         it = outflux_index.insert(std::make_pair(flux, (int) outfluxes.size())).first;
+                                         outfluxes.push_back(flux);
+                                     }
+                                     outflux = it->second;
+                                 }
+                                 entries.push_back(std::make_pair(i, batch_entry{h0, outflux, genus_factor}));
+                             }
+                             if (outfluxes.size() >= batch_chunk_outfluxes){
+                                 flush();
+                             }
+                         });
+    flush();
+    
+    // (3) Complete the distributions (the derived bucket is the total minus all other buckets)
+    // (3) Complete the distributions (the derived bucket is the total minus all other buckets)
+    for (int i = 0; i < degrees.size(); i++){
+        if (derived[i] >= 0){
+            dists[i][derived[i]] = problem_totals[i] - std::accumulate(dists[i].begin(), dists[i].end(), (boost::multiprecision::cpp_int) 0);
+        }
+        dists[i].resize(h0_max + 1);
+    }
+    return dists;
+    
+}
+
+
+std::vector<int> RootCountBatch::h0_tops() const
+{
+    std::vector<int> tops;
+    for (int i = 0; i < degrees.size(); i++){
+        tops.push_back(closed_form_h0_top(degrees[i], genera, graph->edge_numbers, root));
+    }
+    return tops;
+}
+
+
+std::vector<boost::multiprecision::cpp_int> RootCountBatch::totals() const
+{
+    std::vector<boost::multiprecision::cpp_int> problem_totals;
+    for (int i = 0; i < degrees.size(); i++){
+        problem_totals.push_back(closed_form_total(degrees[i], genera, *graph, root));
+    }
+    return problem_totals;
+}
+
+
+std::vector<long long> RootCountBatch::outflux_counts(const int & h0_max) const
+{
+    std::vector<int> h0_minima;
+    for (int i = 0; i < degrees.size(); i++){
+        int total_degree = std::accumulate(degrees[i].begin(), degrees[i].end(), 0);
+        h0_minima.push_back(std::max(0, (int)(total_degree/root) - genus + 1));
+    }
+    std::vector<long long> counts(degrees.size(), 0);
+    walk_batch_outfluxes(degrees, genera, graph->edge_numbers, graph->edges.size(), root, h0_minima, h0_max,
+                         [&counts](const std::vector<int> &, const int &, const boost::multiprecision::int128_t &, const std::vector<int> & fluxes){
+                             for (int i : fluxes){
+                                 counts[i]++;
+                             }
+                         });
+    return counts;
+}
+
+
+std::vector<double> RootCountBatch::predicted_costs(const int & h0_max) const
+{
+    
+    // random descents from sampled outfluxes (nothing is enumerated), shared outfluxes split among their problems
+    std::vector<int> h0_minima;
+    for (int i = 0; i < degrees.size(); i++){
+        int total_degree = std::accumulate(degrees[i].begin(), degrees[i].end(), 0);
+        h0_minima.push_back(std::max(0, (int)(total_degree/root) - genus + 1));
+    }
+    std::vector<double> costs = estimate_batch_states(degrees, genera, graph->edge_numbers, graph->edges.size(), root, graph->plan,
+                                                      h0_minima, h0_max, 256, 31);
+    return costs;
+    
+}
+
+
+// Number of weight assignments of every outflux (without genus factors)
+std::vector<boost::multiprecision::cpp_int> RootCountBatch::outflux_weights(
+                   const std::vector<std::vector<int>> & outfluxes,
+                   RootCountThreadPool * pool,
+                   const RootCountEngine & engine ) const
+{
+    
+    std::vector<boost::multiprecision::cpp_int> weights(outfluxes.size(), 0);
+    if (outfluxes.size() == 0){
+        return weights;
+    }
+    
+    // the genus factors are applied per problem, so the workers see only genus zero vertices
+    // (and never read the partitions, for which the outfluxes are passed)
+    std::vector<int> no_genera(genera.size(), 0);
+    int packages = number_of_packages(pool, outfluxes.size());
+    int package_size = (int) outfluxes.size()/packages;
+    
+    // multi-modular count of every outflux
+    if (engine == RootCountEngine::modular){
+        int number_of_primes = primes.size();
+        std::vector<std::vector<uint64_t>> residues(number_of_primes, std::vector<uint64_t>(outfluxes.size(), 0));
+        run_packages(pool, number_of_primes * packages, [&](int j, int node){
+            int q = j / packages;
+            int i = j % packages;
+            int first = i * package_size;
+            int last = (i < packages - 1) ? (i+1) * package_size : (int) outfluxes.size();
+            progress_counters * counters = start_package(progress);
+            for (int o = first; o < last; o++){
+                modular_worker(no_genera, root, graph->plan_for_node(node), outfluxes, outfluxes, o, o+1, primes[q], partition_tables[q], residues[q][o], counters);
+            }
+            finish_package(counters);
+        });
+        std::vector<uint64_t> outflux_residues(number_of_primes, 0);
+        for (int o = 0; o < outfluxes.size(); o++){
+            for (int q = 0; q < number_of_primes; q++){
+                outflux_residues[q] = residues[q][o];
+            }
+            weights[o] = crt_reconstruct(outflux_residues, primes);
+        }
+        return weights;
+    }
+    
+    // meet-in-the-middle: suffix counts of the keys of all outfluxes, then one join per outflux
+    std::vector<boost::multiprecision::int128_t> int128_weights(outfluxes.size(), 0);
+    if (engine == RootCountEngine::meet_in_the_middle){
+        int split = choose_split(root, graph->plan, outfluxes);
+        std::vector<flux_table> package_tables(packages);
+        run_packages(pool, packages, [&](int i, int node){
+            int first = i * package_size;
+            int last = (i < packages - 1) ? (i+1) * package_size : (int) outfluxes.size();
+            progress_counters * counters = start_package(progress);
+            prefix_worker(no_genera, root, graph->plan_for_node(node), split, outfluxes, outfluxes, first, last, package_tables[i], counters);
+            finish_package(counters);
+        });
+        flux_table suffix_counts;
+        for (int i = 0; i < packages; i++){
+            for (flux_table::const_iterator it = package_tables[i].begin(); it != package_tables[i].end(); it++){
+                suffix_counts[it->first] = 0;
+            }
+            flux_table().swap(package_tables[i]);
+        }
+        std::vector<std::vector<int>> keys;
+        for (flux_table::const_iterator it = suffix_counts.begin(); it != suffix_counts.end(); it++){
+            keys.push_back(it->first);
+        }
+        int key_packages = number_of_packages(pool, keys.size());
+        int key_package_size = (int) keys.size()/key_packages;
+        run_packages(pool, key_packages, [&](int i, int node){
+            int first = i * key_package_size;
+            int last = (i < key_packages - 1) ? (i+1) * key_package_size : (int) keys.size();
+            progress_counters * counters = start_package(progress);
+            suffix_count_worker(root, graph->plan_for_node(node), split, keys, first, last, suffix_counts, counters);
+            finish_package(counters);
+        });
+        run_packages(pool, packages, [&](int i, int node){
+            int first = i * package_size;
+            int last = (i < packages - 1) ? (i+1) * package_size : (int) outfluxes.size();
+            progress_counters * counters = start_package(progress);
+            join_worker(root, graph->plan_for_node(node), split, outfluxes, first, last, suffix_counts, int128_weights, counters);
+            finish_package(counters);
+        });
+    }
+    
+    // frontier: states are only merged within the same outflux (tagged by its index)
+    else if (engine == RootCountEngine::frontier){
+        flux_frontier frontier = initial_frontier(no_genera, root, outfluxes, outfluxes, true);
+        int128_weights = count_frontier(pool, progress, *graph, root, frontier, outfluxes.size(), frontier_memory);
+    }
+    
+    // depth-first search for every outflux
+    else{
+        run_packages(pool, packages, [&](int i, int node){
+            int first = i * package_size;
+            int last = (i < packages - 1) ? (i+1) * package_size : (int) outfluxes.size();
+            progress_counters * counters = start_package(progress);
+            for (int o = first; o < last; o++){
+                worker(no_genera, root, graph->plan_for_node(node), outfluxes, outfluxes, o, o+1, int128_weights[o], counters);
+            }
+            finish_package(counters);
+        });
+    }
+    for (int o = 0; o < outfluxes.size(); o++){
+        weights[o] = (boost::multiprecision::cpp_int) int128_weights[o];
+    }
+    return weights;
+    
+}
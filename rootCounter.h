@@ -0,0 +1,421 @@
+// Library interface for counting (limit) root bundles on full blowups of nodal curves.
+//
+// A RootCountProblem holds all data of one diagram (precomputed once) and offers const methods,
+// which can be called concurrently from several threads on a shared RootCountThreadPool.
+// No global variables are used.
+
+#ifndef ROOT_COUNTER_H
+#define ROOT_COUNTER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <string>
+#include <vector>
+#include <boost/multiprecision/cpp_int.hpp>
+#include <boost/thread/thread.hpp>
+
+
+// Engines for the counting
+enum class RootCountEngine{
+    int128,             // depth-first search with int128 arithmetic
+    modular,            // depth-first search modulo several primes and CRT reconstruction
+    meet_in_the_middle, // prefix states aggregated by residual flux at a split level, joined with the suffix counts
+    frontier            // one level at a time, states aggregated by residual flux on every level (DFS beyond a memory budget)
+};
+
+
+// Thread pool shared by any number of root count computations
+// (the thread calling count/distribution takes part in the computation, so a pool of size 0 is valid).
+// The threads are spread over the NUMA nodes of the machine and have one task queue per node;
+// idle threads steal tasks from other nodes unless a task is bound to its node.
+class RootCountThreadPool{
+
+public:
+    
+    // thread_number < 0: detect_thread_number() - 1 threads (one CPU is left for the calling thread)
+    // pin_threads: pin every thread to one CPU (otherwise threads are only bound to their NUMA node on multi-socket hosts)
+    explicit RootCountThreadPool(const int & thread_number, const bool & pin_threads = false);
+    ~RootCountThreadPool();
+    RootCountThreadPool(const RootCountThreadPool &) = delete;
+    RootCountThreadPool & operator=(const RootCountThreadPool &) = delete;
+    
+    // number of threads in the pool
+    int size() const;
+    
+    // number of NUMA nodes and number of threads of the pool on a node
+    int number_of_nodes() const;
+    int threads_on_node(const int & node) const;
+    
+    // NUMA node of the calling thread (0 if unknown)
+    int current_node() const;
+    
+    // queue a task (node < 0: any node; bound: only threads of this node may run the task)
+    void post(const std::function<void()> & task, const int & node = -1, const bool & bound = false);
+
+private:
+    
+    struct queued_task{
+        std::function<void()> task;
+        bool bound;
+    };
+    
+    void run(const int & node);
+    
+    boost::thread_group threads;
+    int thread_number;
+    std::vector<std::vector<int>> node_cpus;
+    std::vector<int> cpu_nodes;
+    std::vector<int> node_threads;
+    std::vector<std::deque<queued_task>> tasks;
+    int next_node;
+    std::mutex tasks_mutex;
+    std::condition_variable tasks_condition;
+    bool stopping;
+
+};
+
+
+// Progress counters of one thread (aligned to a cache line and only updated by relaxed atomic operations)
+struct alignas(64) progress_counters{
+    std::atomic<long long> outfluxes;   // outfluxes completed
+    std::atomic<long long> states;      // DFS states visited
+    std::atomic<int> active;            // number of packages in progress
+    progress_counters() : outfluxes(0), states(0), active(0) {}
+};
+
+
+// Progress, throughput and ETA reporting: a background thread periodically writes a machine-readable (JSON) status file
+// (with an empty status_file, only the counters are kept).
+// The workers only touch the counters of their own slot, so no locks are taken on the hot path.
+class RootCountProgress{
+
+public:
+    
+    RootCountProgress(const std::string & status_file, const double & interval_seconds = 10, const int & number_of_slots = 64);
+    ~RootCountProgress();
+    RootCountProgress(const RootCountProgress &) = delete;
+    RootCountProgress & operator=(const RootCountProgress &) = delete;
+    
+    // fluxes of this run (e.g. lines of a flux file)
+    void set_fluxes_total(const long long & total);
+    void flux_done(const int & n = 1);
+    
+    // counters of the calling thread
+    progress_counters * counters();
+    
+    // write the status file now (also done periodically and at destruction)
+    void write_status();
+    
+    // number of DFS states visited so far
+    long long states_visited() const;
+    
+    // frontier engine: number of aggregated states on a level, and a fall back to DFS (memory budget exceeded)
+    void frontier_level(const int & level, const long long & states);
+    void frontier_fallback();
+    
+    // largest frontier seen on every level so far
+    std::vector<long long> frontier_sizes() const;
+
+private:
+    
+    void report();
+    
+    std::string status_file;
+    double interval_seconds;
+    long long generation;
+    int number_of_slots;
+    std::vector<progress_counters> slots;
+    std::atomic<int> next_slot;
+    std::atomic<long long> fluxes_done;
+    std::atomic<long long> fluxes_total;
+    
+    // state of the reporter (moving averages of the rates)
+    std::mutex report_mutex;
+    std::chrono::steady_clock::time_point start_time;
+    std::chrono::steady_clock::time_point last_time;
+    long long last_fluxes;
+    long long last_outfluxes;
+    long long last_states;
+    std::vector<long long> last_slot_states;
+    double flux_rate;
+    double outflux_rate;
+    double state_rate;
+    std::vector<double> slot_state_rates;
+    
+    // frontier sizes (rarely updated, so a lock is fine)
+    mutable std::mutex frontier_mutex;
+    std::vector<long long> largest_frontiers;
+    long long frontier_fallbacks;
+    
+    // reporter thread
+    std::mutex stop_mutex;
+    std::condition_variable stop_condition;
+    bool stopping;
+    boost::thread reporter;
+
+};
+
+
+// One (level, neighbour) pair of the graph_stratification
+struct stratification_step{
+    int vertex;             // neighbour of the vertex eliminated at this level
+    int connecting_edges;   // number of edges between the eliminated vertex and the neighbour
+    int remaining_edges;    // number of edges of the neighbour which are left after this level
+};
+
+
+// Immutable, contiguous form of the graph_stratification (level k owns steps[level_offsets[k]], ..., steps[level_offsets[k+1]-1])
+struct graph_plan{
+    
+    std::vector<stratification_step> steps;
+    std::vector<int> level_offsets;
+    int max_connecting_edges;
+    
+    int number_of_levels() const { return (int) level_offsets.size() - 1; }
+    int level_size(const int & k) const { return level_offsets[k+1] - level_offsets[k]; }
+    const stratification_step * level(const int & k) const { return steps.data() + level_offsets[k]; }
+
+};
+
+
+// Graph information of a diagram, computed once and shared read-only by all computations on this diagram (only the
+// deletion-contraction of the closed-form totals is filled in on first use)
+struct RootCountGraph{
+    
+    RootCountGraph(const std::vector<std::vector<int>> & edges, const int & number_of_vertices);
+    
+    // place one copy of the plan on every NUMA node of the pool (first touch by a thread of the node)
+    void replicate(RootCountThreadPool & pool);
+    
+    // plan to be read by threads of the given NUMA node
+    const graph_plan & plan_for_node(const int & node) const;
+    
+    // leaves of the deletion-contraction for the closed-form totals of the edges between the vertices which are not special
+    // (special[j] = 1), computed once per set of special vertices and root (nullptr if there are too many edges)
+    std::shared_ptr<const std::map<std::vector<int>, boost::multiprecision::cpp_int>> total_leaves(const std::vector<int> & special, const int & root) const;
+    
+    std::vector<std::vector<int>> edges;
+    std::vector<int> edge_numbers;
+    std::vector<std::vector<std::vector<int>>> graph_stratification;
+    graph_plan plan;
+    std::vector<std::shared_ptr<const graph_plan>> node_plans;
+    
+    // cache of total_leaves (key: root followed by special)
+    mutable std::mutex total_mutex;
+    mutable std::map<std::vector<int>, std::shared_ptr<const std::map<std::vector<int>, boost::multiprecision::cpp_int>>> total_cache;
+
+};
+
+
+// Result of a Monte Carlo estimate of a root count
+struct RootCountEstimate{
+    double estimate;            // unbiased estimate of the count
+    double standard_error;      // standard error of the estimate
+    double lower;               // confidence interval [lower, upper]
+    double upper;
+    long long samples;          // number of sampled descents
+    long long outfluxes;        // number of outfluxes for this h0 (estimated from the same descents)
+};
+
+
+// Counting problem for one diagram with given (reduced) degrees and root
+class RootCountProblem{
+
+public:
+    
+    RootCountProblem(
+                     const int & genus,
+                     const std::vector<int> & degrees,
+                     const std::vector<int> & genera,
+                     const std::vector<std::vector<int>> & edges,
+                     const int & root );
+    RootCountProblem(
+                     const std::shared_ptr<const RootCountGraph> & graph,
+                     const int & genus,
+                     const std::vector<int> & degrees,
+                     const std::vector<int> & genera,
+                     const int & root );
+    
+    // report progress of all following computations (nullptr to switch off)
+    void set_progress(RootCountProgress * progress);
+    
+    // memory budget of the frontier engine in bytes (default 1 GiB)
+    void set_frontier_memory(const size_t & bytes);
+    
+    // smallest h0 with possibly non-zero count
+    int h0_min() const;
+    
+    // largest h0 with possibly non-zero count
+    int h0_top() const;
+    
+    // number of roots summed over all h0, from the nowhere-zero Z_root flows on the graph (without counting any h0)
+    // (-1 if the weights at genus one vertices with h = 0 are too many to enumerate)
+    boost::multiprecision::cpp_int total() const;
+    
+    // predicted work (number of DFS states) of distribution(h0_max), from random descents from sampled outfluxes
+    // (a fixed number of descents of O(vertices + edges) each, used to schedule the heaviest problems first)
+    double predicted_cost(const int & h0_max) const;
+    
+    // number of roots with h0 = h0_value
+    boost::multiprecision::cpp_int count(
+                     const int & h0_value,
+                     RootCountThreadPool * pool = nullptr,
+                     const RootCountEngine & engine = RootCountEngine::int128 ) const;
+    
+    // number of roots with h0 = 0, 1, ..., h0_max
+    std::vector<boost::multiprecision::cpp_int> distribution(
+                     const int & h0_max,
+                     RootCountThreadPool * pool = nullptr,
+                     const RootCountEngine & engine = RootCountEngine::int128 ) const;
+    
+    // Monte Carlo estimate of the number of roots with h0 = h0_value, computed within the given number of seconds
+    // (z is the quantile of the confidence interval, e.g. 1.96 for 95%; seed = 0 picks a random seed)
+    RootCountEstimate estimate(
+                     const int & h0_value,
+                     const double & seconds,
+                     RootCountThreadPool * pool = nullptr,
+                     const double & z = 1.96,
+                     const uint64_t & seed = 0 ) const;
+
+private:
+    
+    void initialize();
+    void outfluxes_for(
+                     const int & h0_value,
+                     std::vector<std::vector<int>> & outfluxes,
+                     std::vector<std::vector<int>> & h0_partitions ) const;
+    
+    std::shared_ptr<const RootCountGraph> graph;
+    int genus;
+    std::vector<int> degrees;
+    std::vector<int> genera;
+    int root;
+    RootCountProgress * progress;
+    size_t frontier_memory;
+    
+    // primes and number_partitions tables for the modular engine
+    std::vector<uint64_t> primes;
+    std::vector<std::vector<std::vector<uint64_t>>> partition_tables;
+
+};
+
+
+// Batch of counting problems on one diagram which only differ by their (reduced) degrees, e.g. consecutive lines of a flux file.
+// The outfluxes of all fluxes and all h0 values are enumerated in one walk through the trie of the reduced degrees, and the
+// weight assignments of every outflux are counted once for the whole batch.
+class RootCountBatch{
+
+public:
+    
+    RootCountBatch(
+                   const std::shared_ptr<const RootCountGraph> & graph,
+                   const int & genus,
+                   const std::vector<std::vector<int>> & degrees,
+                   const std::vector<int> & genera,
+                   const int & root );
+    
+    // report progress of all following computations (nullptr to switch off)
+    void set_progress(RootCountProgress * progress);
+    
+    // memory budget of the frontier engine in bytes (default 1 GiB)
+    void set_frontier_memory(const size_t & bytes);
+    
+    // number of problems in the batch
+    int size() const;
+    
+    // for every problem of the batch: number of roots with h0 = 0, 1, ..., h0_max
+    // (derive = true: the bucket with the most outfluxes is not counted but derived as the total minus all other buckets
+    // up to h0_top, which are then counted even above h0_max; only where this saves outfluxes and a total is available)
+    std::vector<std::vector<boost::multiprecision::cpp_int>> distributions(
+                   const int & h0_max,
+                   RootCountThreadPool * pool = nullptr,
+                   const RootCountEngine & engine = RootCountEngine::int128,
+                   const bool & derive = false ) const;
+    
+    // for every problem of the batch: largest h0 with possibly non-zero count, and the number of roots summed over all h0
+    // (see RootCountProblem)
+    std::vector<int> h0_tops() const;
+    std::vector<boost::multiprecision::cpp_int> totals() const;
+    
+    // for every problem of the batch: number of outfluxes with h0 <= h0_max (one walk through the trie, nothing is counted)
+    std::vector<long long> outflux_counts(const int & h0_max) const;
+    
+    // for every problem of the batch: predicted work of its distribution up to h0_max (see RootCountProblem::predicted_cost),
+    // where an outflux which several problems share is split among them, so the sum is the work of the whole batch
+    // (which counts a shared outflux once)
+    std::vector<double> predicted_costs(const int & h0_max) const;
+
+private:
+    
+    std::vector<boost::multiprecision::cpp_int> outflux_weights(
+                   const std::vector<std::vector<int>> & outfluxes,
+                   RootCountThreadPool * pool,
+                   const RootCountEngine & engine ) const;
+    
+    std::shared_ptr<const RootCountGraph> graph;
+    int genus;
+    std::vector<std::vector<int>> degrees;
+    std::vector<int> genera;
+    int root;
+    RootCountProgress * progress;
+    size_t frontier_memory;
+    
+    // primes and number_partitions tables for the modular engine
+    std::vector<uint64_t> primes;
+    std::vector<std::vector<std::vector<uint64_t>>> partition_tables;
+
+};
+
+
+// Number of threads to use (ROOTCOUNTER_THREADS if set, otherwise usable CPUs limited by the cgroup CPU quota)
+int detect_thread_number();
+
+// Instruction set of the counting kernels: "auto" (best one supported by the CPU, the default), "avx512", "avx2" or "baseline"
+// (the environment variable ROOTCOUNTER_ISA sets the initial choice)
+// Output: false if the instruction set is unknown or not supported by this CPU
+bool set_counting_isa(const std::string & isa);
+std::string counting_isa();
+
+// Compute edge_numbers and graph_stratification of a diagram
+void additional_graph_information(
+                                  const std::vector<std::vector<int>> & edges,
+                                  std::vector<int> & edge_numbers,
+                                  std::vector<std::vector<std::vector<int>>> & graph_stratification );
+
+// Compile the graph_stratification into a graph_plan
+graph_plan compile_graph_plan(const std::vector<std::vector<std::vector<int>>> & graph_stratification);
+
+// Count number of root bundles with prescribed number of sections (one-shot, spawns its own threads)
+boost::multiprecision::int128_t parallel_root_counter(
+                                const int genus,
+                                const std::vector<int> & degrees,
+                                const std::vector<int> & genera,
+                                const std::vector<std::vector<int>> & edges,
+                                const int root,
+                                const std::vector<std::vector<std::vector<int>>> & graph_stratification,
+                                const std::vector<int> & edge_numbers,
+                                const int & h0_value,
+                                const int & thread_number,
+                                const bool & display_details = false );
+
+// Same as parallel_root_counter, but by multi-modular arithmetic
+boost::multiprecision::cpp_int modular_root_counter(
+                                const int genus,
+                                const std::vector<int> & degrees,
+                                const std::vector<int> & genera,
+                                const std::vector<std::vector<int>> & edges,
+                                const int root,
+                                const std::vector<std::vector<std::vector<int>>> & graph_stratification,
+                                const std::vector<int> & edge_numbers,
+                                const int & h0_value,
+                                const int & thread_number,
+                                const bool & display_details = false );
+
+#endif